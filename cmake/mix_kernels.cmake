@@ -0,0 +1,19 @@
+# Each SIMD kernel file gets its own instruction set, the rest stays at the baseline and the CPU is checked at run time.
+# Source properties only hold in the directory that sets them, so every directory building the kernels calls this.
+function(mix_kernel_sources SOURCE_DIR OUTPUT)
+    set(KERNELS
+        ${SOURCE_DIR}/mix_kernels.cc
+        ${SOURCE_DIR}/mix_kernels_sse2.cc
+        ${SOURCE_DIR}/mix_kernels_avx2.cc)
+
+    if(CMAKE_SYSTEM_PROCESSOR MATCHES "x86_64|AMD64|i[3-6]86")
+        if(MSVC)
+            set_source_files_properties(${SOURCE_DIR}/mix_kernels_avx2.cc PROPERTIES COMPILE_FLAGS /arch:AVX2)
+        else()
+            set_source_files_properties(${SOURCE_DIR}/mix_kernels_sse2.cc PROPERTIES COMPILE_FLAGS -msse2)
+            set_source_files_properties(${SOURCE_DIR}/mix_kernels_avx2.cc PROPERTIES COMPILE_FLAGS -mavx2)
+        endif()
+    endif()
+
+    set(${OUTPUT} ${KERNELS} PARENT_SCOPE)
+endfunction()
@@ -12,9 +12,13 @@ extern "C" {
 #endif
 
 /* GLcore API */
+typedef void (*GLcoreproc)(void);
+typedef GLcoreproc (*GLcoreloader)(const char *proc);
+
 int glLoadFunctions(void);
 int glLoadExtensions(void);
 void *nativeGetProcAddress(const char *proc);
+void glSetProcLoader(GLcoreloader loader); /* overrides SDL loader, e.g. for EGL contexts */
 
 /* OpenGL functions */
 extern PFNGLCULLFACEPROC _glCullFace;
@@ -0,0 +1,132 @@
+#include <cstdio>
+#include <cstring>
+#include <cstdlib>
+#include <algorithm>
+#include <filesystem>
+#include <string>
+
+#include <SDL2/SDL.h>
+
+#include "config.hh"
+#include "journal.hh"
+#include "utils.hh"
+#include "mapped_file.hh"
+#include "archive.hh"
+
+namespace resources {
+
+    // Offsets and sizes come from the file, so the checks are written not to wrap
+    static auto is_within(const uint64_t offset, const uint64_t size, const uint64_t limit) -> bool {
+        return size <= limit && offset <= limit - size;
+    }
+
+    static auto is_valid_entry(const ARCHIVE_HEADER &header, const ARCHIVE_ENTRY &entry, const size_t file_size) -> bool {
+        return is_within(entry.name_offset, entry.name_size, header.names_size) && is_within(entry.offset, entry.size, file_size);
+    }
+
+    // A loose asset edited after packing would be hidden by its packed copy, the whole archive is skipped then
+    static auto is_stale(const std::string_view path) -> bool {
+        namespace fs = std::filesystem;
+
+        std::error_code ec;
+        const auto packed = fs::last_write_time(fs::path{path}, ec);
+        if (ec)
+            return false;
+
+        for (const auto &entry : fs::recursive_directory_iterator(GAME_ASSETS_DIR, ec)) {
+            std::error_code entry_ec;
+            if (!entry.is_regular_file(entry_ec) || entry.last_write_time(entry_ec) <= packed || entry_ec)
+                continue;
+
+            journal::warning("Archive '%1' is older than '%2', loose assets are used until asset_archive is run again", path, entry.path().string());
+            return true;
+        }
+
+        return false;
+    }
+
+    auto open_archive(const std::string_view path) -> std::optional<archive_t> {
+        const auto file = map_file(path);
+        if (!file)
+            return {};
+
+        archive_t archive;
+        archive.file = file.value();
+
+        const auto header = reinterpret_cast<const ARCHIVE_HEADER*>(archive.file.data);
+
+        const auto size = static_cast<uint64_t>(archive.file.size);
+
+        auto valid = size >= sizeof(ARCHIVE_HEADER)
+                && memcmp(header->magic, ARCHIVE_MAGIC, sizeof header->magic) == 0
+                && header->version == ARCHIVE_VERSION
+                && header->index_offset <= size
+                && header->count <= (size - header->index_offset) / sizeof(ARCHIVE_ENTRY)
+                && is_within(header->names_offset, header->names_size, size);
+
+        // Every entry once here, so lookups can trust the index
+        const auto entries = valid ? reinterpret_cast<const ARCHIVE_ENTRY*>(archive.file.data + header->index_offset) : nullptr;
+        for (uint32_t i = 0; valid && i < header->count; i++)
+            valid = is_valid_entry(*header, entries[i], archive.file.size);
+
+        if (!valid) {
+            journal::error("Invalid archive '%1'", path);
+            close_archive(archive);
+            return {};
+        }
+
+        if (is_stale(path)) {
+            close_archive(archive);
+            return {};
+        }
+
+        archive.entries = entries;
+        archive.count = header->count;
+        archive.names = reinterpret_cast<const char*>(archive.file.data + header->names_offset);
+
+        journal::debug("Archive '%1' opened with %2 entries", path, archive.count);
+
+        return archive;
+    }
+
+    auto close_archive(archive_t &archive) -> void {
+        if (!archive.file.data)
+            return;
+
+        unmap_file(archive.file);
+
+        archive = archive_t{};
+    }
+
+    auto find_blob(const archive_t &archive, const std::string_view name) -> std::optional<blob_t> {
+        if (!archive.entries)
+            return {};
+
+        const auto hash = hash_fnv1a(name);
+
+        const auto first = archive.entries;
+        const auto last = archive.entries + archive.count;
+
+        // Hash collisions are possible, so walk every entry with the same hash and compare names
+        for (auto it = std::lower_bound(first, last, hash, [] (const ARCHIVE_ENTRY &e, const uint64_t h) {
+            return e.name_hash < h;
+        }); it != last && it->name_hash == hash; ++it) {
+            const auto entry_name = std::string_view{archive.names + it->name_offset, it->name_size};
+            if (entry_name != name)
+                continue;
+
+            return blob_t{archive.file.data + it->offset, static_cast<size_t>(it->size), it->content_hash};
+        }
+
+        return {};
+    }
+
+    auto open_asset(const archive_t &archive, const std::string_view name) -> SDL_RWops* {
+        if (const auto blob = find_blob(archive, name); blob)
+            return SDL_RWFromConstMem(blob.value().data, static_cast<int>(blob.value().size));
+
+        const auto path = GAME_ASSETS_DIR + std::string{"/"} + std::string{name};
+        return SDL_RWFromFile(path.c_str(), "rb");
+    }
+
+} // namespace resources
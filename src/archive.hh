@@ -0,0 +1,66 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <string_view>
+#include <optional>
+
+#include "mapped_file.hh"
+
+// Packed assets: header, index sorted by name hash, names, then data blobs aligned to 16 bytes
+
+constexpr char ARCHIVE_MAGIC[4] = {'A', 'R', 'K', 'A'};
+constexpr uint32_t ARCHIVE_VERSION = 1;
+constexpr uint64_t ARCHIVE_ALIGNMENT = 16;
+
+#pragma pack(push, archive_align)
+#pragma pack(1)
+typedef struct ArchiveHeader
+{
+    char        magic[4];
+    uint32_t    version;
+    uint32_t    count;
+    uint32_t    names_size;
+    uint64_t    index_offset;
+    uint64_t    names_offset;
+} ARCHIVE_HEADER;
+
+typedef struct ArchiveEntry
+{
+    uint64_t    name_hash;
+    uint64_t    content_hash;
+    uint64_t    offset;
+    uint64_t    size;
+    uint32_t    name_offset;
+    uint32_t    name_size;
+} ARCHIVE_ENTRY;
+#pragma pack(pop, archive_align)
+
+typedef struct SDL_RWops SDL_RWops;
+
+namespace resources {
+
+    typedef struct blob_type {
+        const uint8_t *data = nullptr;
+        size_t size = 0;
+        uint64_t hash = 0;
+    } blob_t;
+
+    typedef struct archive_type {
+        archive_type() = default;
+
+        mapped_file_t file;
+        const ARCHIVE_ENTRY *entries = nullptr;
+        uint32_t count = 0;
+        const char *names = nullptr;
+    } archive_t;
+
+    auto open_archive(const std::string_view path) -> std::optional<archive_t>;
+    auto close_archive(archive_t &archive) -> void;
+
+    auto find_blob(const archive_t &archive, const std::string_view name) -> std::optional<blob_t>;
+
+    // View into the archive when the asset is packed, a file in the assets dir otherwise
+    auto open_asset(const archive_t &archive, const std::string_view name) -> SDL_RWops*;
+
+} // namespace resources
@@ -1,10 +1,19 @@
+#include <algorithm>
+
 #include "audio.hh"
 #include "journal.hh"
+#include "game.hh"
 
 #ifdef OPENAL_BACKEND
 
+#include <SDL2/SDL.h>
+
 #include "openal_backend.inl"
 
+#elif SOFTWARE_MIXER_BACKEND
+
+#include "software_mixer_backend.inl"
+
 #elif SDL_MIXER_BACKEND
 
 #include "sdl_mixer_backend.inl"
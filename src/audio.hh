@@ -2,8 +2,12 @@
 
 #include <optional>
 #include <array>
+#include <memory>
 
 #include "resources.hh"
+#include "music_stream.hh"
+#include "pcm_convert.hh"
+#include "callback_stats.hh"
 
 namespace game {
 
@@ -16,6 +20,7 @@ namespace audio {
 
     constexpr int MAX_AUDIO_VOLUME = 128;
     constexpr size_t MAX_AUDIO_SOURCES = 8;
+    constexpr size_t MUSIC_BUFFERS = 4; // queued on the OpenAL music source
 
 } // namespace audio
 
@@ -28,6 +33,25 @@ namespace audio {
 
     inline namespace al_backend {
 
+        // Source state is predicted from when the sound was started, the driver is never asked
+        typedef struct voice_type {
+            voice_type() = default;
+
+            uint32_t source = 0;
+            uint64_t start = 0;
+            uint64_t end = 0; // performance counter ticks, max for looped sounds
+            int32_t priority = 0;
+            float gain = 0.0f;
+        } voice_t;
+
+        typedef struct voice_stats_type {
+            voice_stats_type() = default;
+
+            uint64_t played = 0;
+            uint64_t stolen = 0;
+            uint64_t dropped = 0;
+        } voice_stats_t;
+
         typedef struct context_type {
             context_type() = default;
 
@@ -36,12 +60,28 @@ namespace audio {
             int volume = MAX_AUDIO_VOLUME;
 
             std::array<uint32_t, MAX_AUDIO_SOURCES> sources;
+            std::array<voice_t, MAX_AUDIO_SOURCES> voices;
+            voice_stats_t stats;
+            std::unique_ptr<callback_stats_t> device_stats; // no callback to time, only voices and music starvation
+
+            // OpenAL has no callback, the buffers are refilled from the stream in update
+            std::unique_ptr<music_stream_t> music;
+            uint32_t music_source = 0;
+            std::array<uint32_t, MUSIC_BUFFERS> music_buffers = {};
+            std::vector<int16_t> music_chunk;
         } context_t;
 
         auto init(game::context_t &ctx) -> std::optional<context_t>;
         auto cleanup(context_t &ctx) -> void;
 
-        auto play_sound(context_t &ctx, const resources::sound_t &sound, const bool looped = false) -> void;
+        auto play_sound(context_t &ctx, const resources::sound_t &sound, const bool looped = false, const float gain = 1.0f) -> void;
+
+        // Streams the track from rw, which is taken over, anything already playing is stopped
+        auto play_music(context_t &ctx, SDL_RWops *rw, const bool looped = true) -> bool;
+        auto stop_music(context_t &ctx) -> void;
+
+        // Once per frame, refills the processed music buffers and reports underruns
+        auto update(context_t &ctx) -> void;
 
         auto enable_sound() -> void;
         auto disabel_sound() -> void;
@@ -67,7 +107,11 @@ namespace resources {
         int32_t frequency = 0;
         uint32_t size = 0;
         audio_format format = audio_format::unknown;
+
+        // Samples already fit for alBufferData are used where they lie, in the archive mapping or the file read
+        const uint8_t *view = nullptr;
         std::vector<uint8_t> bytes;
+        size_t offset = 0; // into bytes
     } wave_t;
 
     typedef struct sound_type {
@@ -77,10 +121,83 @@ namespace resources {
         int32_t size = 0;
         int32_t format = 0;
         int32_t frequency = 0;
+        int32_t priority = 0; // higher steals voices from lower
     } sound_t;
 
 } // namespace resources
 
+#elif SOFTWARE_MIXER_BACKEND
+
+#include <memory>
+#include <vector>
+
+#include <SDL2/SDL_audio.h>
+
+#include "mixer.hh"
+
+namespace resources {
+
+    // Converted to the mixer format when loaded, interleaved stereo int16
+    typedef struct wave_type {
+        wave_type() = default;
+
+        std::vector<int16_t> samples;
+        int32_t frequency = 0;
+    } wave_t;
+
+    typedef struct sound_type {
+        sound_type() = default;
+
+        const int16_t *samples = nullptr;
+        uint32_t frames = 0;
+        int32_t frequency = 0;
+        int32_t priority = 0;
+    } sound_t;
+
+} // namespace resources
+
+namespace audio {
+
+    inline namespace mixer_backend {
+
+        typedef struct context_type {
+            context_type() = default;
+
+            SDL_AudioDeviceID device = 0;
+            std::unique_ptr<mixer_t> mixer;
+            int volume = MAX_AUDIO_VOLUME;
+            device_format_t format;
+
+            // Null device opens nothing, render mixes into output on the calling thread
+            bool null_device = false;
+            std::vector<int16_t> output;
+
+            std::unique_ptr<music_stream_t> music;
+        } context_t;
+
+        // Headless runs get the null device
+        auto init(game::context_t &ctx) -> std::optional<context_t>;
+        auto init_null_device() -> std::optional<context_t>;
+        auto cleanup(context_t &ctx) -> void;
+
+        auto play_sound(context_t &ctx, const resources::sound_t &sound, const bool looped = false, const float gain = 1.0f) -> void;
+        auto stop_sound(context_t &ctx, const resources::sound_t &sound) -> void;
+        auto change_volume(context_t &ctx, int volume) -> void;
+
+        // Streams the track from rw, which is taken over, anything already playing is stopped
+        auto play_music(context_t &ctx, SDL_RWops *rw, const bool looped = true) -> bool;
+        auto stop_music(context_t &ctx) -> void;
+
+        // Once per frame, reports music underruns and collects latency samples
+        auto update(context_t &ctx) -> void;
+
+        // Mixes frames into output when running on the null device, does nothing otherwise
+        auto render(context_t &ctx, const size_t frames) -> void;
+
+    } // namespace mixer_backend
+
+} // namespace audio
+
 #elif SDL_MIXER_BACKEND
 
 #include <SDL2/SDL_audio.h>
@@ -94,6 +211,7 @@ namespace resources {
         sound_type() = default;
 
         wave_t chunk = nullptr;
+        int32_t priority = 0;
     } sound_t;
 
 } // namespace resources
@@ -111,16 +229,38 @@ namespace audio {
             int volume = MAX_AUDIO_VOLUME;
         } playback_t;
 
+        // Shared with the SDL_mixer hooks, the music hook runs before the channels are mixed and the post mix one after
+        typedef struct mix_hooks_type {
+            mix_hooks_type() = default;
+
+            latency_probe_t latency;
+            callback_stats_t stats;
+            uint64_t start = 0; // audio thread only
+
+            music_stream_t *music = nullptr; // only swapped under the audio lock
+        } mix_hooks_t;
+
         typedef struct context_type {
             context_type() = default;
 
             SDL_AudioDeviceID device;
+            device_format_t format;
+
+            std::unique_ptr<music_stream_t> music;
+            std::unique_ptr<mix_hooks_t> hooks;
         } context_t;
 
         auto init(game::context_t &ctx) -> std::optional<context_t>;
         auto cleanup(context_t &ctx) -> void;
 
-        auto play_sound(context_t &ctx, const resources::sound_t &sound, const bool looped = false) -> void;
+        auto play_sound(context_t &ctx, const resources::sound_t &sound, const bool looped = false, const float gain = 1.0f) -> void;
+
+        // Streams the track from rw, which is taken over, anything already playing is stopped
+        auto play_music(context_t &ctx, SDL_RWops *rw, const bool looped = true) -> bool;
+        auto stop_music(context_t &ctx) -> void;
+
+        // Once per frame, reports music underruns and collects latency samples
+        auto update(context_t &ctx) -> void;
 
         auto enable_sound() -> void;
         auto disabel_sound() -> void;
@@ -136,6 +276,9 @@ namespace resources {
 
     auto create_sound(const wave_t &wave) -> std::optional<sound_t>;
 
+    // Seconds, worked out from the loaded data without asking the device
+    auto get_sound_duration(const sound_t &snd) -> float;
+
     auto destroy_sound(sound_t &snd) -> void;
 
 } // namespace resources
@@ -0,0 +1,65 @@
+#include "journal.hh"
+#include "callback_stats.hh"
+
+namespace audio {
+
+    // Bucket holding the p-th value, the count is taken once so a busy audio thread can't move it past the end
+    static auto percentile_bucket(const histogram_t &hist, const float p) -> size_t {
+        uint64_t total = 0;
+        std::array<uint64_t, HISTOGRAM_BUCKETS> counts = {};
+        for (size_t i = 0; i < HISTOGRAM_BUCKETS; i++) {
+            counts[i] = hist.buckets[i].load(std::memory_order_relaxed);
+            total += counts[i];
+        }
+
+        const auto rank = static_cast<uint64_t>(p * static_cast<float>(total));
+        uint64_t seen = 0;
+        for (size_t i = 0; i < HISTOGRAM_BUCKETS; i++) {
+            seen += counts[i];
+            if (seen > rank)
+                return i;
+        }
+
+        return HISTOGRAM_BUCKETS - 1;
+    }
+
+    // Upper bounds, the histograms only know which bucket a value fell in
+    static auto log2_limit(const size_t bucket) -> uint64_t {
+        return uint64_t{2} << bucket;
+    }
+
+    static auto linear_limit(const size_t bucket, const uint64_t width) -> uint64_t {
+        return (bucket + 1) * width;
+    }
+
+    static auto mean(const histogram_t &hist) -> double {
+        const auto count = hist.count.load(std::memory_order_relaxed);
+        return count > 0 ? static_cast<double>(hist.sum.load(std::memory_order_relaxed)) / static_cast<double>(count) : 0.0;
+    }
+
+    auto report_callback_stats(const callback_stats_t &stats) -> void {
+        const auto callbacks = stats.callbacks.load(std::memory_order_relaxed);
+
+        if (callbacks > 0) {
+            journal::info("Audio callbacks %1, mix time us mean %2 p50 < %3 p99 < %4 max %5", callbacks, mean(stats.mix_us),
+                          log2_limit(percentile_bucket(stats.mix_us, 0.5f)), log2_limit(percentile_bucket(stats.mix_us, 0.99f)),
+                          stats.mix_us.max.load(std::memory_order_relaxed));
+
+            journal::info("Audio budget used percent mean %1 p50 < %2 p99 < %3 max %4", mean(stats.budget_percent),
+                          linear_limit(percentile_bucket(stats.budget_percent, 0.5f), BUDGET_BUCKET_PERCENT),
+                          linear_limit(percentile_bucket(stats.budget_percent, 0.99f), BUDGET_BUCKET_PERCENT),
+                          stats.budget_percent.max.load(std::memory_order_relaxed));
+        }
+
+        if (stats.voices.count.load(std::memory_order_relaxed) > 0)
+            journal::info("Active voices mean %1 p99 < %2 max %3", mean(stats.voices),
+                          linear_limit(percentile_bucket(stats.voices, 0.99f), VOICES_BUCKET),
+                          stats.voices.max.load(std::memory_order_relaxed));
+
+        const auto underruns = stats.underruns.load(std::memory_order_relaxed);
+        const auto xruns = stats.xruns.load(std::memory_order_relaxed);
+        if (underruns + xruns > 0)
+            journal::warning("Audio underruns %1, callbacks over budget %2", underruns, xruns);
+    }
+
+} // namespace audio
@@ -0,0 +1,99 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <array>
+#include <atomic>
+
+#include "latency_probe.hh"
+
+// What the audio thread does with its time, written there and read from the game thread without locks
+
+namespace audio {
+
+    constexpr size_t HISTOGRAM_BUCKETS = 16;
+    constexpr uint64_t BUDGET_BUCKET_PERCENT = 10; // last bucket holds everything from 150 % up
+    constexpr uint64_t VOICES_BUCKET = 2;
+
+    static_assert(std::atomic<uint64_t>::is_always_lock_free, "the audio thread must never block on the stats");
+
+    typedef struct histogram_type {
+        histogram_type() = default;
+
+        std::array<std::atomic<uint64_t>, HISTOGRAM_BUCKETS> buckets = {};
+        std::atomic<uint64_t> count{0};
+        std::atomic<uint64_t> sum{0};
+        std::atomic<uint64_t> max{0};
+    } histogram_t;
+
+    typedef struct callback_stats_type {
+        callback_stats_type() = default;
+
+        histogram_t mix_us; // bucket i holds [2^i, 2^(i+1)) microseconds
+        histogram_t budget_percent; // mix time over the duration of the block it filled
+        histogram_t voices;
+
+        std::atomic<uint64_t> callbacks{0};
+        std::atomic<uint64_t> underruns{0}; // callback came late, the device ran dry meanwhile
+        std::atomic<uint64_t> xruns{0}; // mixing took longer than the block lasts
+
+        // Audio thread only, frequency is set before the device starts
+        int frequency = 0;
+        uint64_t last_start = 0;
+    } callback_stats_t;
+
+    // Only ever one writer, relaxed adds are enough for readers that just want totals
+    inline auto record(histogram_t &hist, const size_t bucket, const uint64_t value) -> void {
+        hist.buckets[bucket < HISTOGRAM_BUCKETS ? bucket : HISTOGRAM_BUCKETS - 1].fetch_add(1, std::memory_order_relaxed);
+        hist.count.fetch_add(1, std::memory_order_relaxed);
+        hist.sum.fetch_add(value, std::memory_order_relaxed);
+
+        if (value > hist.max.load(std::memory_order_relaxed))
+            hist.max.store(value, std::memory_order_relaxed);
+    }
+
+    inline auto log2_bucket(uint64_t value) -> size_t {
+        size_t bucket = 0;
+        while (value > 1 && bucket < HISTOGRAM_BUCKETS - 1) {
+            value >>= 1;
+            bucket++;
+        }
+
+        return bucket;
+    }
+
+    inline auto record_voices(callback_stats_t &stats, const uint32_t voices) -> void {
+        record(stats.voices, voices / VOICES_BUCKET, voices);
+    }
+
+    // Audio thread, once the block of frames is written, start is probe_now from the top of the callback
+    inline auto end_callback(callback_stats_t &stats, const uint64_t start, const size_t frames, const uint32_t voices) -> void {
+        const auto end = probe_now();
+        const auto mix_ns = end - start;
+        const auto block_ns = stats.frequency > 0 ? static_cast<uint64_t>(frames) * 1000000000u / static_cast<uint64_t>(stats.frequency) : 0;
+
+        // A device that wants a block every block_ns gave up waiting long before the next call
+        if (stats.last_start != 0 && block_ns != 0 && start - stats.last_start > block_ns + block_ns / 2)
+            stats.underruns.fetch_add(1, std::memory_order_relaxed);
+
+        if (block_ns != 0 && mix_ns > block_ns)
+            stats.xruns.fetch_add(1, std::memory_order_relaxed);
+
+        stats.last_start = start;
+        stats.callbacks.fetch_add(1, std::memory_order_relaxed);
+
+        const auto mix_us = mix_ns / 1000;
+        record(stats.mix_us, log2_bucket(mix_us), mix_us);
+
+        if (block_ns != 0) {
+            const auto percent = mix_ns * 100 / block_ns;
+            record(stats.budget_percent, percent / BUDGET_BUCKET_PERCENT, percent);
+        }
+
+        record_voices(stats, voices);
+    }
+
+    // Game thread, logs everything seen since the device was opened
+    auto report_callback_stats(const callback_stats_t &stats) -> void;
+
+} // namespace audio
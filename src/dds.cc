@@ -0,0 +1,52 @@
+#include <optional>
+#include <SDL2/SDL_rwops.h>
+
+#include "resources.hh"
+#include "dds.hh"
+
+auto load_dds(SDL_RWops *rw) -> std::optional<resources::image_t> {
+    if (!rw)
+        return {};
+
+    const auto lenght = SDL_RWsize(rw);
+
+    DDS_HEADER header;
+    if (lenght < static_cast<Sint64>(sizeof header) || SDL_RWread(rw, &header, sizeof header, 1) != 1) {
+        SDL_RWclose(rw);
+        return {};
+    }
+
+    if (header.magic != DDS_MAGIC || !(header.pixel_format.flags & DDPF_FOURCC)) {
+        SDL_RWclose(rw);
+        return {};
+    }
+
+    resources::image_t image;
+
+    switch (header.pixel_format.fourcc) {
+    case DDS_FOURCC_DXT1:
+        image.format = resources::pixel_format::bc1;
+        break;
+    case DDS_FOURCC_DXT5:
+        image.format = resources::pixel_format::bc3;
+        break;
+    default:
+        SDL_RWclose(rw);
+        return {};
+    }
+
+    image.width = header.width;
+    image.height = header.height;
+    image.depth = 0;
+    image.mip_levels = (header.flags & DDSD_MIPMAPCOUNT) && header.mipmap_count > 0 ? header.mipmap_count : 1;
+
+    // All levels follow the header back to back, read them with one call
+    image.pixels.resize(static_cast<size_t>(lenght) - sizeof header);
+    const auto readen = image.pixels.empty() ? 0 : SDL_RWread(rw, &image.pixels[0], image.pixels.size(), 1);
+    SDL_RWclose(rw);
+
+    if (readen != 1)
+        return {};
+
+    return image;
+}
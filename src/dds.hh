@@ -0,0 +1,59 @@
+#pragma once
+
+#include <cstdint>
+
+// Subset of DirectDraw Surface layout, enough for BC1/BC3 textures with mipmaps
+
+constexpr uint32_t DDS_MAGIC = 0x20534444; // "DDS "
+
+constexpr uint32_t DDS_FOURCC_DXT1 = 0x31545844; // "DXT1"
+constexpr uint32_t DDS_FOURCC_DXT5 = 0x35545844; // "DXT5"
+
+enum DDS_FLAGS : uint32_t {
+    DDSD_CAPS = 0x1,
+    DDSD_HEIGHT = 0x2,
+    DDSD_WIDTH = 0x4,
+    DDSD_PIXELFORMAT = 0x1000,
+    DDSD_MIPMAPCOUNT = 0x20000,
+    DDSD_LINEARSIZE = 0x80000,
+    DDPF_FOURCC = 0x4,
+    DDSCAPS_COMPLEX = 0x8,
+    DDSCAPS_TEXTURE = 0x1000,
+    DDSCAPS_MIPMAP = 0x400000
+};
+
+#pragma pack(push, dds_header_align)
+#pragma pack(1)
+typedef struct DDSPixelFormat
+{
+    uint32_t    size;
+    uint32_t    flags;
+    uint32_t    fourcc;
+    uint32_t    rgb_bit_count;
+    uint32_t    r_mask;
+    uint32_t    g_mask;
+    uint32_t    b_mask;
+    uint32_t    a_mask;
+} DDS_PIXELFORMAT;
+
+typedef struct DDSHeader
+{
+    uint32_t    magic;
+    uint32_t    size;
+    uint32_t    flags;
+    uint32_t    height;
+    uint32_t    width;
+    uint32_t    linear_size;
+    uint32_t    depth;
+    uint32_t    mipmap_count;
+    uint32_t    reserved1[11];
+    DDS_PIXELFORMAT pixel_format;
+    uint32_t    caps;
+    uint32_t    caps2;
+    uint32_t    caps3;
+    uint32_t    caps4;
+    uint32_t    reserved2;
+} DDS_HEADER;
+#pragma pack(pop, dds_header_align)
+
+static_assert(sizeof(DDS_HEADER) == 128, "DDS header must be 128 bytes");
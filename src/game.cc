@@ -7,7 +7,6 @@
 
 #include <SDL2/SDL.h>
 #include <GL/glcore.h>
-#include <json.hpp>
 
 #include "config.hh"
 #include "journal.hh"
@@ -17,8 +16,9 @@
 #include "audio.hh"
 #include "collisions.hh"
 #include "particle_emitter.hh"
-
-using json = nlohmann::json;
+#include "mapped_file.hh"
+#include "manifest.hh"
+#include "trace.hh"
 
 namespace game {
 
@@ -61,7 +61,7 @@ namespace game {
         player.color = vec3{1.f};
     }
 
-    auto spawn_powerups(context_t &ctx, object& target) {
+    auto spawn_powerups(context_t &ctx, const object &target) {
         if (random(1, 100) < 15) {
             powerup_object p;
             p.type = powerup_t::speed;
@@ -144,32 +144,30 @@ namespace game {
         }
     }
 
-    auto do_collisions(context_t &ctx, audio::context_t &atx) {
+    auto do_collisions(context_t &ctx) {
         using namespace glm;
 
         auto &level = ctx.level;
         auto &player = ctx.player;
         auto &ball = ctx.ball;
 
-        for (auto &box : level.bricks) {
-            if (!box.is_destroyed) {
+        const auto &bricks = level.level->bricks;
+        for (size_t i = 0; i < bricks.size(); i++) {
+            const auto &box = bricks[i];
+            if (!is_brick_destroyed(level, i)) {
                 auto [overlapped, dir, diff_vector] = check_collison(ball, box);
 
                 if (overlapped) {
                     if (!box.is_solid) {
-                        box.is_destroyed = true;
+                        destroy_brick(level, i);
                         spawn_powerups(ctx, box);
-                        auto snd = resources::get_sound(ctx, "bleep");
-                        if (snd)
-                            audio::play_sound(atx, snd.value());
+                        audio::queue_sound(ctx.sound_events, "bleep");
 
                     } else {
                         ctx.shake_time = 0.5f;
                         ctx.render_options |= video::OP_SHAKE;
 
-                        auto snd = resources::get_sound(ctx, "solid");
-                        if (snd)
-                            audio::play_sound(atx, snd.value());
+                        audio::queue_sound(ctx.sound_events, "solid");
                     }
 
                     if (!(!box.is_solid && ball.is_pass_through)) {
@@ -221,9 +219,7 @@ namespace game {
                     powerup.is_activated = true;
                     powerup.is_destroyed = true;
 
-                    auto snd = resources::get_sound(ctx, "powerup");
-                    if (snd)
-                        audio::play_sound(atx, snd.value());
+                    audio::queue_sound(ctx.sound_events, "powerup");
                 }
             }
         }
@@ -275,33 +271,78 @@ namespace game {
         }), ctx.powerups.end());
     }
 
-    auto init(const std::string_view conf_path, const bool debug) -> std::optional<context_t> {
+    auto init(const std::string_view conf_path, const bool debug, const bool headless) -> std::optional<context_t> {
         using namespace std;
 
-        if (SDL_Init(SDL_INIT_EVERYTHING) != 0) {
-            journal::critical("Unable to initialize SDL: %1", SDL_GetError());
-            return {};
+        // Servers running headless have neither display nor sound card
+        if (headless)
+            SDL_setenv("SDL_AUDIODRIVER", "dummy", 0);
+
+        {
+            const trace::scope_t scope{"SDL_Init"};
+
+            if (SDL_Init(headless ? SDL_INIT_TIMER | SDL_INIT_AUDIO | SDL_INIT_EVENTS : SDL_INIT_EVERYTHING) != 0) {
+                journal::critical("Unable to initialize SDL: %1", SDL_GetError());
+                return {};
+            }
         }
 
         atexit(SDL_Quit);
 
-        auto contents = get_config(conf_path);
-        if (!contents) {
+        auto file = resources::map_file(conf_path);
+        if (!file) {
             journal::critical("%1", "Can't read game config");
             return {};
         }
 
-        auto j = json::parse(contents.value());
+        manifest::game_conf_t conf;
+        const auto parsed = manifest::read_game_conf({reinterpret_cast<const char*>(file.value().data), file.value().size}, conf_path, conf);
+        resources::unmap_file(file.value());
 
-        if (j.find("video") == j.end()) {
+        if (!parsed || !conf.has_video) {
             journal::critical("%1", "Can't read video settings from config");
             return {};
         }
 
-        auto video_conf = j["video"];
+        const auto window_width = conf.width;
+        const auto window_height = conf.height;
+        const auto texture_memory = conf.texture_memory != 0 ? conf.texture_memory * 1024 * 1024 : TEXTURE_MEMORY_BUDGET;
+
+        // Only a request, audio::init replaces it with what the device really opened
+        audio::device_format_t audio_format;
+        if (conf.audio_frequency > 0)
+            audio_format.frequency = conf.audio_frequency;
+        if (conf.audio_buffer > 0)
+            audio_format.buffer_frames = conf.audio_buffer;
+
+        if (headless) {
+#ifdef HEADLESS_MODE
+            const trace::scope_t scope{"create offscreen context"};
+
+            auto offscreen = headless::create_context(window_width, window_height, debug);
+            if (!offscreen) {
+                journal::critical("%1", "Init offscreen graphics error");
+                return {};
+            }
 
-        const auto window_width = (video_conf.find("width") != video_conf.end()) ? video_conf["width"].get<int>() : 1024;
-        const auto window_height = (video_conf.find("height") != video_conf.end()) ? video_conf["height"].get<int>() : 768;
+            glLoadFunctions();
+            glLoadExtensions();
+
+            context_t ctx;
+            ctx.offscreen = offscreen.value();
+            ctx.headless = true;
+            ctx.textures.budget = texture_memory;
+            ctx.music_track = conf.music;
+            ctx.audio_format = audio_format;
+            ctx.width = window_width;
+            ctx.height = window_height;
+
+            return ctx;
+#else
+            journal::critical("%1", "Built without headless mode");
+            return {};
+#endif // HEADLESS_MODE
+        }
 
         SDL_GL_SetAttribute(SDL_GL_DOUBLEBUFFER, 1);
         SDL_GL_SetAttribute(SDL_GL_CONTEXT_MAJOR_VERSION, 3);
@@ -310,6 +351,8 @@ namespace game {
         SDL_GL_SetAttribute(SDL_GL_CONTEXT_PROFILE_MASK, SDL_GL_CONTEXT_PROFILE_CORE);
         SDL_GL_SetAttribute(SDL_GL_CONTEXT_FLAGS, SDL_GL_CONTEXT_FORWARD_COMPATIBLE_FLAG | (debug ? SDL_GL_CONTEXT_DEBUG_FLAG : 0));
 
+        const trace::scope_t scope{"create window and GL context"};
+
         const auto window = SDL_CreateWindow(GAME_TITLE, SDL_WINDOWPOS_CENTERED, SDL_WINDOWPOS_CENTERED, window_width, window_height, SDL_WINDOW_OPENGL | SDL_WINDOW_SHOWN);
         if (!window) {
             journal::critical("%1 %2", "Create window error: ", SDL_GetError());
@@ -322,12 +365,19 @@ namespace game {
             return {};
         }
 
-        glLoadFunctions();
-        glLoadExtensions();
+        {
+            const trace::scope_t load_scope{"glLoadFunctions"};
+
+            glLoadFunctions();
+            glLoadExtensions();
+        }
 
         context_t ctx;
         ctx.window = window;
         ctx.graphic = graphic;
+        ctx.textures.budget = texture_memory;
+        ctx.music_track = conf.music;
+        ctx.audio_format = audio_format;
 
         SDL_GetWindowSize(window, &ctx.width, &ctx.height);
 
@@ -335,26 +385,49 @@ namespace game {
     }
 
     auto start(context_t &ctx) -> bool {
-        if (!resources::init(ctx, GAME_ASSETS_PATH)) {
-            journal::critical("%1", "Init resources error");
-            return false;
+        {
+            const trace::scope_t scope{"create workers"};
+            ctx.workers = workers::create_pool();
+        }
+
+        {
+            const trace::scope_t scope{"resources"};
+
+            if (!resources::init(ctx, GAME_ASSETS_PATH)) {
+                journal::critical("%1", "Init resources error");
+                return false;
+            }
         }
 
-        const auto levels = load_levels(ctx, GAME_LEVELS_PATH, ctx.width, ctx.height * 0.5f);
-        if (levels.empty()) {
+        // Compiled pack is preferred while it matches the JSON, which stays the authoring format and the fallback
+        const trace::scope_t scope{"levels"};
+
+        auto sources = load_level_pack(GAME_LEVEL_PACK_PATH, GAME_LEVELS_PATH, ctx.levels.pack);
+        if (sources.empty())
+            sources = load_levels(GAME_LEVELS_PATH);
+
+        if (sources.empty()) {
             journal::critical("%1", "Couldn't load levels");
             return false;
         }
 
-        ctx.levels = levels;
+        ctx.levels.built.resize(sources.size());
+        ctx.levels.sources = std::move(sources);
 
         const auto player_tex = resources::get_texture(ctx, "paddle");
         if (!player_tex) {
             journal::critical("%1", "Couldn't init player");
             return false;
         }
+        // Only the first level is built now, the next one is built in the background
         ctx.current_level = 0;
-        ctx.level = levels[ctx.current_level];
+        enter_level(ctx.level, instantiate_level(ctx, ctx.current_level));
+        if (!ctx.level.level) {
+            journal::critical("%1", "Couldn't build first level");
+            return false;
+        }
+
+        preload_level(ctx, (ctx.current_level + 1) % ctx.levels.sources.size());
 
         ctx.player.texture = player_tex.value();
         ctx.player.position = vec2{ctx.width / 2.f - PLAYER_SIZE.x / 2.f, ctx.height - PLAYER_SIZE.y};
@@ -427,20 +500,53 @@ namespace game {
         }
     }
 
-    auto update(context_t &ctx, audio::context_t &atx, const float dt) -> void {
+    auto next_level(context_t &ctx) -> void {
+        const auto count = ctx.levels.sources.size();
+        const auto previous = ctx.current_level;
+
+        journal::info("Level '%1' complete", ctx.level.level->name);
+
+        ctx.current_level = (ctx.current_level + 1) % count;
+
+        // Usually a pointer handover of the preloaded level
+        if (auto level = instantiate_level(ctx, ctx.current_level); level)
+            enter_level(ctx.level, std::move(level));
+        else
+            reset_level(ctx.level);
+
+        // Finished levels are rebuilt when they come round again
+        const auto next = (ctx.current_level + 1) % count;
+        if (previous != ctx.current_level && previous != next)
+            ctx.levels.built[previous].reset();
+
+        preload_level(ctx, next);
+
+        reset_player(ctx, ctx.player);
+        reset_ball(ctx, ctx.ball);
+        reset_emitter(ctx.particles);
+        ctx.powerups.clear();
+    }
+
+    auto update(context_t &ctx, const float dt) -> void {
+        ctx.sound_events.tick++;
+
         move_ball(ctx.ball, dt, ctx.width);
-        do_collisions(ctx, atx);
+        do_collisions(ctx);
 
         update_emitter(ctx.particles, dt, ctx.ball, ctx.ball.is_stuck ? 0 : 1, vec2{ctx.ball.radius/2});
 
         update_powerups(ctx, dt);
 
+        poll_level_preload(ctx);
+
         if (ctx.ball.position.y >= ctx.height) {
             reset_player(ctx, ctx.player);
             reset_ball(ctx, ctx.ball);
             reset_emitter(ctx.particles);
             ctx.powerups.clear();
-            ctx.level = ctx.levels[ctx.current_level];
+            reset_level(ctx.level);
+        } else if (ctx.level.remaining == 0 && ctx.level.level->breakable > 0) {
+            next_level(ctx);
         }
 
         if (ctx.shake_time > 0.f) {
@@ -458,29 +564,46 @@ namespace game {
                 video::draw_sprite(gtx, background_tex.value(), {0, 0}, {ctx.width, ctx.height}, 0.0f, {1.0f, 1.0f, 1.0f});*/
 
             const auto &level = ctx.level;
-            for (const auto& sp : level.bricks) {
-                if (!sp.is_destroyed)
-                    video::draw_sprite(gtx, sp.texture, sp.position, sp.size, sp.rotate, sp.color);
+            const auto &bricks = level.level->bricks;
+            for (size_t i = 0; i < bricks.size(); i++) {
+                const auto &sp = bricks[i];
+                if (!is_brick_destroyed(level, i))
+                    video::draw_sprite(gtx, resources::use_texture(ctx, sp.texture), sp.position, sp.size, sp.rotate, sp.color);
             }
 
             const auto &player = ctx.player;
-            video::draw_sprite(gtx, player.texture, player.position, player.size, player.rotate, player.color);
+            video::draw_sprite(gtx, resources::use_texture(ctx, player.texture), player.position, player.size, player.rotate, player.color);
 
             for (const auto &powerup : ctx.powerups)
                 if (!powerup.is_destroyed)
-                    video::draw_sprite(gtx, powerup.texture, powerup.position, powerup.size, 0.f, powerup.color);
+                    video::draw_sprite(gtx, resources::use_texture(ctx, powerup.texture), powerup.position, powerup.size, 0.f, powerup.color);
 
-            const auto &particles = ctx.particles;
-            video::draw_particles(gtx, particles);
+            ctx.particles.texture = resources::use_texture(ctx, ctx.particles.texture);
+            video::draw_particles(gtx, ctx.particles);
 
             const auto &ball = ctx.ball;
-            video::draw_sprite(gtx, ball.texture, ball.position, ball.size, ball.rotate, ball.color);
+            video::draw_sprite(gtx, resources::use_texture(ctx, ball.texture), ball.position, ball.size, ball.rotate, ball.color);
         }
     }
 
     auto cleanup(context_t &ctx) -> void {
+        audio::report_sound_events(ctx.sound_events);
+
         resources::cleanup(ctx);
 
+        // Preload jobs may still read tiles from the pack mapping
+        if (ctx.workers)
+            workers::destroy_pool(*ctx.workers);
+
+        cleanup_levels(ctx.levels);
+
+#ifdef HEADLESS_MODE
+        if (ctx.headless) {
+            headless::destroy_context(ctx.offscreen);
+            return;
+        }
+#endif // HEADLESS_MODE
+
         SDL_GL_DeleteContext(ctx.graphic);
         SDL_DestroyWindow(ctx.window);
     }
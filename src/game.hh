@@ -3,15 +3,22 @@
 #include <variant>
 #include <unordered_map>
 #include <fstream>
+#include <memory>
 
 #include <SDL2/SDL.h>
 #include <glm/glm.hpp>
 
 #include "resources.hh"
+#include "upload_queue.hh"
+#include "texture_cache.hh"
+#include "archive.hh"
+#include "worker_pool.hh"
 #include "particle_emitter.hh"
 #include "level.hh"
 #include "utils.hh"
 #include "audio.hh"
+#include "sound_events.hh"
+#include "headless.hh"
 
 namespace video {
 
@@ -76,20 +83,30 @@ namespace game {
     typedef struct context_type {
         SDL_Window *window = nullptr;
         SDL_GLContext graphic = nullptr;
+        headless::context_t offscreen;
+        bool headless = false;
 
         state_t state = state_t::active;
 
         std::unordered_map<std::string, resources::shader_t> shaders;
-        std::unordered_map<std::string, resources::texture_t> textures;
+        resources::texture_cache_t textures;
         std::unordered_map<std::string, resources::sound_t> sounds;
-
-        std::vector<level_t> levels;
+        std::unordered_map<std::string, std::string> music; // name to source, streamed when played
+        std::string music_track;
+        std::vector<resources::postprocess_t> postprocess;
+        resources::upload_queue_t uploads;
+        resources::archive_t archive;
+        std::unique_ptr<workers::pool_t> workers;
+
+        level_catalog_t levels;
         size_t current_level = 0;
-        level_t level;
+        level_state_t level;
         object player;
         ball_object ball;
         particle_emitter particles;
         std::vector<powerup_object> powerups;
+        audio::sound_events_t sound_events;
+        audio::device_format_t audio_format; // game.conf request until audio::init, sounds are converted to it
         float shake_time = 0.0f;
 
         uint32_t render_options = 0;
@@ -100,10 +117,10 @@ namespace game {
     } context_t;
 
 
-    auto init(const std::string_view conf_path, const bool debug) -> std::optional<context_t>;
+    auto init(const std::string_view conf_path, const bool debug, const bool headless = false) -> std::optional<context_t>;
     auto start(context_t &ctx) -> bool;
     auto process_events(context_t &ctx, const float dt) -> void;
-    auto update(context_t &ctx, audio::context_t &atx, const float dt) -> void;
+    auto update(context_t &ctx, const float dt) -> void;
     auto draw(context_t &ctx, video::context_t &gtx) -> void;
     auto cleanup(context_t &ctx) -> void;
 } // namespace game
@@ -5,14 +5,23 @@
 
 #include <SDL2/SDL.h>
 
+static GLcoreloader proc_loader = NULL;
+
+void glSetProcLoader(GLcoreloader loader)
+{
+	proc_loader = loader;
+}
+
 static void open_libgl(void)
 {
-	SDL_GL_LoadLibrary(NULL);
+	if (!proc_loader)
+		SDL_GL_LoadLibrary(NULL);
 }
 
 static void close_libgl(void)
 {
-	SDL_GL_UnloadLibrary();
+	if (!proc_loader)
+		SDL_GL_UnloadLibrary();
 }
 
 typedef void (*VOIDFUNC)(void);
@@ -25,6 +34,9 @@ static VOIDFUNC get_proc(const char *proc)
         VOIDFUNC f;
     } ptr;
 
+    if (proc_loader)
+        return proc_loader(proc);
+
     ptr.p = SDL_GL_GetProcAddress(proc);
 
     return ptr.f;
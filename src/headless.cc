@@ -0,0 +1,303 @@
+#include <cstdio>
+#include <cstring>
+#include <algorithm>
+#include <numeric>
+#include <fstream>
+#include <sstream>
+
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+
+#include <SDL2/SDL.h>
+#include <GL/glcore.h>
+
+#include "journal.hh"
+#include "headless.hh"
+
+namespace headless {
+
+    static auto has_egl_extension(EGLDisplay display, const char *name) -> bool {
+        const auto extensions = eglQueryString(display, EGL_EXTENSIONS);
+        if (!extensions)
+            return false;
+
+        const auto len = strlen(name);
+        for (auto p = strstr(extensions, name); p; p = strstr(p + len, name)) {
+            if (p[len] == ' ' || p[len] == '\0')
+                return true;
+        }
+
+        return false;
+    }
+
+    static auto get_display() -> EGLDisplay {
+        // Surfaceless platform needs neither X11 nor a DRM device, so it works with llvmpipe on servers
+        if (has_egl_extension(EGL_NO_DISPLAY, "EGL_MESA_platform_surfaceless")) {
+            const auto get_platform_display = reinterpret_cast<PFNEGLGETPLATFORMDISPLAYEXTPROC>(eglGetProcAddress("eglGetPlatformDisplayEXT"));
+
+            if (get_platform_display) {
+                const auto display = get_platform_display(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, nullptr);
+                if (display != EGL_NO_DISPLAY)
+                    return display;
+            }
+        }
+
+        return eglGetDisplay(EGL_DEFAULT_DISPLAY);
+    }
+
+    auto create_context(const int width, const int height, const bool debug) -> std::optional<context_t> {
+        const auto display = get_display();
+        if (display == EGL_NO_DISPLAY) {
+            journal::critical("%1", "Can't get EGL display");
+            return {};
+        }
+
+        EGLint major = 0, minor = 0;
+        if (!eglInitialize(display, &major, &minor)) {
+            journal::critical("Can't initialize EGL: %1", eglGetError());
+            return {};
+        }
+
+        journal::debug("EGL %1.%2 %3", major, minor, eglQueryString(display, EGL_VENDOR));
+
+        if (!eglBindAPI(EGL_OPENGL_API)) {
+            journal::critical("%1", "EGL has no desktop OpenGL");
+            eglTerminate(display);
+            return {};
+        }
+
+        // Default surface type is window, which surfaceless displays never offer
+        const EGLint config_attribs[] = {
+            EGL_SURFACE_TYPE, EGL_PBUFFER_BIT,
+            EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT,
+            EGL_RED_SIZE, 8,
+            EGL_GREEN_SIZE, 8,
+            EGL_BLUE_SIZE, 8,
+            EGL_ALPHA_SIZE, 8,
+            EGL_NONE
+        };
+
+        EGLConfig config = nullptr;
+        EGLint num_configs = 0;
+        if (!eglChooseConfig(display, config_attribs, &config, 1, &num_configs) || num_configs == 0) {
+            journal::critical("%1", "No suitable EGL config");
+            eglTerminate(display);
+            return {};
+        }
+
+        const EGLint context_attribs[] = {
+            EGL_CONTEXT_MAJOR_VERSION_KHR, 3,
+            EGL_CONTEXT_MINOR_VERSION_KHR, 3,
+            EGL_CONTEXT_OPENGL_PROFILE_MASK_KHR, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT_KHR,
+            EGL_CONTEXT_FLAGS_KHR, EGL_CONTEXT_OPENGL_FORWARD_COMPATIBLE_BIT_KHR | (debug ? EGL_CONTEXT_OPENGL_DEBUG_BIT_KHR : 0),
+            EGL_NONE
+        };
+
+        const auto context = eglCreateContext(display, config, EGL_NO_CONTEXT, context_attribs);
+        if (context == EGL_NO_CONTEXT) {
+            journal::critical("Can't create GL 3.3 core context: %1", eglGetError());
+            eglTerminate(display);
+            return {};
+        }
+
+        // Scene goes to an FBO anyway, a pbuffer is only needed when the driver can't go surfaceless
+        auto surface = EGL_NO_SURFACE;
+        if (!has_egl_extension(display, "EGL_KHR_surfaceless_context")) {
+            const EGLint pbuffer_attribs[] = {
+                EGL_WIDTH, width,
+                EGL_HEIGHT, height,
+                EGL_NONE
+            };
+
+            surface = eglCreatePbufferSurface(display, config, pbuffer_attribs);
+            if (surface == EGL_NO_SURFACE) {
+                journal::critical("Can't create pbuffer: %1", eglGetError());
+                eglDestroyContext(display, context);
+                eglTerminate(display);
+                return {};
+            }
+        }
+
+        if (!eglMakeCurrent(display, surface, surface, context)) {
+            journal::critical("Can't make EGL context current: %1", eglGetError());
+            if (surface != EGL_NO_SURFACE)
+                eglDestroySurface(display, surface);
+            eglDestroyContext(display, context);
+            eglTerminate(display);
+            return {};
+        }
+
+        glSetProcLoader(eglGetProcAddress);
+
+        context_t ctx;
+        ctx.display = display;
+        ctx.surface = surface;
+        ctx.context = context;
+
+        return ctx;
+    }
+
+    auto destroy_context(context_t &ctx) -> void {
+        if (!ctx.display)
+            return;
+
+        eglMakeCurrent(ctx.display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+
+        if (ctx.surface)
+            eglDestroySurface(ctx.display, ctx.surface);
+
+        eglDestroyContext(ctx.display, ctx.context);
+        eglTerminate(ctx.display);
+
+        ctx = context_t{};
+    }
+
+    static auto get_key(const std::string_view name) -> int32_t {
+        if (name == "left")
+            return SDLK_LEFT;
+        if (name == "right")
+            return SDLK_RIGHT;
+        if (name == "space")
+            return SDLK_SPACE;
+        if (name == "a")
+            return SDLK_a;
+        if (name == "d")
+            return SDLK_d;
+        if (name == "escape")
+            return SDLK_ESCAPE;
+
+        return 0;
+    }
+
+    auto load_script(const std::string_view path) -> std::optional<std::vector<script_event_t>> {
+        using namespace std;
+
+        ifstream fs(path.data());
+        if (!fs.is_open()) {
+            journal::error("Can't open script '%1'", path);
+            return {};
+        }
+
+        vector<script_event_t> events;
+
+        // Every line is '<frame> <key> [down|up]', '#' starts a comment
+        string line;
+        auto line_number = 0;
+        while (getline(fs, line)) {
+            line_number++;
+
+            if (const auto comment = line.find('#'); comment != string::npos)
+                line.resize(comment);
+
+            istringstream ss{line};
+            script_event_t ev;
+            string key, state;
+            if (!(ss >> ev.frame))
+                continue;
+
+            ss >> key >> state;
+
+            ev.key = get_key(key);
+            ev.pressed = state != "up";
+
+            if (ev.key == 0) {
+                journal::error("Unknown key '%1' at %2:%3", key, path, line_number);
+                return {};
+            }
+
+            events.push_back(ev);
+        }
+
+        stable_sort(events.begin(), events.end(), [] (const auto &a, const auto &b) {
+            return a.frame < b.frame;
+        });
+
+        return events;
+    }
+
+    auto save_frame(const std::string_view path, const uint32_t framebuffer, const int width, const int height) -> bool {
+        std::vector<uint8_t> pixels(static_cast<size_t>(width) * height * 3);
+
+        glBindFramebuffer(GL_READ_FRAMEBUFFER, framebuffer);
+        glPixelStorei(GL_PACK_ALIGNMENT, 1);
+        glReadPixels(0, 0, width, height, GL_BGR, GL_UNSIGNED_BYTE, &pixels[0]);
+        glPixelStorei(GL_PACK_ALIGNMENT, 4);
+        glBindFramebuffer(GL_READ_FRAMEBUFFER, 0);
+
+        auto fp = fopen(path.data(), "wb");
+        if (!fp) {
+            journal::error("Can't write '%1'", path);
+            return false;
+        }
+
+        // Bottom-up rows match GL read back order, no flip needed
+        uint8_t header[18] = {};
+        header[2] = 2; // uncompressed true color
+        header[12] = static_cast<uint8_t>(width & 0xff);
+        header[13] = static_cast<uint8_t>(width >> 8);
+        header[14] = static_cast<uint8_t>(height & 0xff);
+        header[15] = static_cast<uint8_t>(height >> 8);
+        header[16] = 24;
+
+        const auto written = fwrite(header, sizeof header, 1, fp) == 1 && fwrite(&pixels[0], pixels.size(), 1, fp) == 1;
+        fclose(fp);
+
+        return written;
+    }
+
+    static auto put_le(uint8_t *dst, const uint32_t value, const size_t size) -> void {
+        for (size_t i = 0; i < size; i++)
+            dst[i] = static_cast<uint8_t>(value >> (i * 8));
+    }
+
+    auto save_wave(const std::string_view path, const std::vector<int16_t> &samples, const int frequency, const int channels) -> bool {
+        auto fp = fopen(path.data(), "wb");
+        if (!fp) {
+            journal::error("Can't write '%1'", path);
+            return false;
+        }
+
+        const auto data_size = static_cast<uint32_t>(samples.size() * sizeof(int16_t));
+        const auto block_align = static_cast<uint32_t>(channels) * sizeof(int16_t);
+
+        // Fields are little endian, so are the samples on every target we build for
+        uint8_t header[44] = {};
+        memcpy(header, "RIFF", 4);
+        put_le(header + 4, 36 + data_size, 4);
+        memcpy(header + 8, "WAVEfmt ", 8);
+        put_le(header + 16, 16, 4);
+        put_le(header + 20, 1, 2); // PCM
+        put_le(header + 22, static_cast<uint32_t>(channels), 2);
+        put_le(header + 24, static_cast<uint32_t>(frequency), 4);
+        put_le(header + 28, static_cast<uint32_t>(frequency) * block_align, 4);
+        put_le(header + 32, block_align, 2);
+        put_le(header + 34, 16, 2);
+        memcpy(header + 36, "data", 4);
+        put_le(header + 40, data_size, 4);
+
+        const auto written = fwrite(header, sizeof header, 1, fp) == 1 && (samples.empty() || fwrite(samples.data(), data_size, 1, fp) == 1);
+        fclose(fp);
+
+        return written;
+    }
+
+    auto report_frame_times(std::vector<float> frame_times) -> void {
+        if (frame_times.empty())
+            return;
+
+        std::sort(frame_times.begin(), frame_times.end());
+
+        const auto percentile = [&frame_times] (const float p) {
+            const auto index = static_cast<size_t>(p * static_cast<float>(frame_times.size() - 1) + 0.5f);
+            return frame_times[index];
+        };
+
+        const auto total = std::accumulate(frame_times.begin(), frame_times.end(), 0.0);
+        const auto average = total / static_cast<double>(frame_times.size());
+
+        journal::info("Frames: %1, total %2 s, %3 FPS", frame_times.size(), total / 1000.0, 1000.0 / average);
+        journal::info("Frame time ms: avg %1 min %2 p50 %3 p95 %4 p99 %5 max %6", average, frame_times.front(),
+                      percentile(0.5f), percentile(0.95f), percentile(0.99f), frame_times.back());
+    }
+
+} // namespace headless
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <optional>
+#include <vector>
+
+namespace headless {
+
+    typedef struct options_type {
+        options_type() = default;
+
+        bool enabled = false;
+        uint32_t frames = 600;
+        uint32_t seed = 1;
+        std::vector<uint32_t> dump_frames;
+        std::string output_dir = ".";
+        std::string script_path;
+        std::string trace_path;
+        std::string audio_path; // audio only render of the session to a wave file, nothing is drawn
+    } options_t;
+
+    typedef struct context_type {
+        context_type() = default;
+
+        void *display = nullptr;
+        void *surface = nullptr;
+        void *context = nullptr;
+    } context_t;
+
+    typedef struct script_event_type {
+        uint32_t frame = 0;
+        int32_t key = 0;
+        bool pressed = true;
+    } script_event_t;
+
+    auto create_context(const int width, const int height, const bool debug) -> std::optional<context_t>;
+    auto destroy_context(context_t &ctx) -> void;
+
+    auto load_script(const std::string_view path) -> std::optional<std::vector<script_event_t>>;
+
+    // Reads back the framebuffer and writes it as uncompressed 24 bit TGA
+    auto save_frame(const std::string_view path, const uint32_t framebuffer, const int width, const int height) -> bool;
+
+    // Interleaved int16 as a plain PCM wave
+    auto save_wave(const std::string_view path, const std::vector<int16_t> &samples, const int frequency, const int channels) -> bool;
+
+    auto report_frame_times(std::vector<float> frame_times) -> void;
+
+} // namespace headless
@@ -0,0 +1,378 @@
+#include <cerrno>
+#include <cstring>
+#include <algorithm>
+#include <filesystem>
+#include <set>
+#include <vector>
+
+#include <sys/inotify.h>
+#include <unistd.h>
+
+#include "journal.hh"
+#include "manifest.hh"
+#include "game.hh"
+#include "video.hh"
+#include "hot_reload.hh"
+
+namespace hot_reload {
+
+    namespace fs = std::filesystem;
+
+    // Editors often replace files by rename, so directories are watched rather than files
+    constexpr uint32_t WATCH_MASK = IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE;
+
+    static auto add_watch(context_t &hr, const std::string &dir) -> void {
+        for (const auto &w : hr.dirs) {
+            if (w.second == dir)
+                return;
+        }
+
+        const auto wd = inotify_add_watch(hr.fd, dir.c_str(), WATCH_MASK);
+        if (wd < 0) {
+            journal::warning("Can't watch '%1': %2", dir, strerror(errno));
+            return;
+        }
+
+        hr.dirs.emplace(wd, dir);
+    }
+
+    static auto add_watch_recursive(context_t &hr, const std::string &dir) -> void {
+        add_watch(hr, dir);
+
+        std::error_code ec;
+        for (const auto &entry : fs::recursive_directory_iterator(dir, ec)) {
+            if (entry.is_directory())
+                add_watch(hr, entry.path().string());
+        }
+    }
+
+    static auto get_program_sources(const manifest::assets_t &assets) -> std::unordered_map<std::string, std::pair<std::string, std::string>> {
+        std::unordered_map<std::string, std::string> shaders;
+        for (const auto &sh : assets.shaders)
+            shaders[sh.name] = sh.source;
+
+        std::unordered_map<std::string, std::pair<std::string, std::string>> programs;
+        for (const auto &p : assets.programs)
+            programs[p.name] = {shaders[p.vertex], shaders[p.fragment]};
+
+        return programs;
+    }
+
+    static auto get_program_hash(const std::pair<std::string, std::string> &sources) -> uint64_t {
+        return hash_fnv1a(sources.second, hash_fnv1a(sources.first));
+    }
+
+    static auto get_level_hash(const manifest::level_t &level) -> uint64_t {
+        const uint64_t shape[] = {level.enable, level.has_data, level.width, level.height};
+        return hash_fnv1a(level.tiles.data(), level.tiles.size(), hash_fnv1a(shape, sizeof shape));
+    }
+
+    // Half-saved JSON is common while editing, nothing comes back unless the whole file reads
+    static auto read_assets(const std::string &path) -> std::optional<manifest::assets_t> {
+        const auto contents = get_config(path);
+        if (!contents)
+            return {};
+
+        manifest::assets_t assets;
+        if (!manifest::read_assets(contents.value(), path, assets))
+            return {};
+
+        return assets;
+    }
+
+    static auto read_levels(const std::string &path) -> std::optional<std::vector<manifest::level_t>> {
+        const auto contents = get_config(path);
+        if (!contents)
+            return {};
+
+        std::vector<manifest::level_t> levels;
+        if (!manifest::read_levels(contents.value(), path, [&levels] (const manifest::level_t &level) { levels.push_back(level); }))
+            return {};
+
+        return levels;
+    }
+
+    auto init(game::context_t &ctx, const std::string_view assets_path, const std::string_view levels_path, const std::string_view assets_dir) -> std::optional<context_t> {
+        context_t hr;
+        hr.assets_path = fs::absolute(assets_path).lexically_normal().string();
+        hr.levels_path = fs::absolute(levels_path).lexically_normal().string();
+        hr.assets_dir = fs::absolute(assets_dir).lexically_normal().string();
+
+        const auto assets = read_assets(hr.assets_path);
+        const auto levels = read_levels(hr.levels_path);
+        if (!assets || !levels) {
+            journal::error("%1", "Can't read configs to watch");
+            return {};
+        }
+
+        for (const auto &p : get_program_sources(assets.value()))
+            hr.programs[p.first] = get_program_hash(p.second);
+
+        for (const auto &level : levels.value())
+            hr.levels[level.name] = get_level_hash(level);
+
+        hr.fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+        if (hr.fd < 0) {
+            journal::error("Can't init inotify: %1", strerror(errno));
+            return {};
+        }
+
+        add_watch(hr, fs::path{hr.assets_path}.parent_path().string());
+        add_watch(hr, fs::path{hr.levels_path}.parent_path().string());
+        add_watch_recursive(hr, hr.assets_dir);
+
+        // Edited files land in the assets dir, a packed copy would shadow them
+        if (ctx.archive.file.data) {
+            journal::info("%1", "Hot reload reads loose assets, packed archive closed");
+            resources::close_archive(ctx.archive);
+        }
+
+        journal::info("Watching %1 directories for changes", hr.dirs.size());
+
+        return hr;
+    }
+
+    static auto reload_assets(game::context_t &ctx, video::context_t &gtx, context_t &hr) -> void {
+        // Keeps running on the old state until the file reads again
+        const auto assets = read_assets(hr.assets_path);
+        if (!assets)
+            return;
+
+        for (const auto &p : get_program_sources(assets.value())) {
+            const auto hash = get_program_hash(p.second);
+            if (hr.programs[p.first] == hash)
+                continue;
+
+            const auto old_id = ctx.shaders.find(p.first) != ctx.shaders.end() ? ctx.shaders[p.first].id : 0u;
+
+            const auto sh = resources::rebuild_program(ctx, p.first, p.second.first, p.second.second);
+            if (!sh) {
+                journal::error("Program '%1' not rebuilt, old one stays", p.first);
+                continue;
+            }
+
+            if (old_id != 0)
+                video::replace_shader(gtx, old_id, sh.value());
+
+            hr.programs[p.first] = hash;
+            journal::info("Program '%1' rebuilt", p.first);
+        }
+
+        for (const auto &t : assets.value().textures) {
+            if (t.source.empty())
+                continue;
+
+            auto entry = resources::find_texture_entry(ctx.textures, t.name);
+            if (!entry) {
+                resources::texture_entry_t e;
+                e.name = t.name;
+                e.source = t.source;
+                e.stream = t.stream;
+                resources::add_texture_entry(ctx.textures, std::move(e));
+
+                journal::info("Texture '%1' added", t.name);
+                continue;
+            }
+
+            if (entry->source == t.source && entry->stream == t.stream)
+                continue;
+
+            entry->source = t.source;
+            entry->stream = t.stream;
+            resources::invalidate_texture(ctx.textures, entry->texture.handle);
+
+            journal::info("Texture '%1' changed", t.name);
+        }
+    }
+
+    // Levels gone from the JSON or disabled leave the rotation, the session finishes the one it is playing
+    static auto drop_levels(game::context_t &ctx, const std::set<std::string> &playable) -> void {
+        auto &catalog = ctx.levels;
+        auto dropped = false;
+
+        for (auto i = catalog.sources.size(); i-- > 0;) {
+            const auto name = catalog.sources[i].name;
+            if (playable.count(name))
+                continue;
+
+            if (catalog.sources.size() == 1) {
+                journal::warning("Level '%1' is the only one left, kept", name);
+                continue;
+            }
+
+            catalog.sources.erase(catalog.sources.begin() + static_cast<std::ptrdiff_t>(i));
+            catalog.built.erase(catalog.built.begin() + static_cast<std::ptrdiff_t>(i));
+            dropped = true;
+
+            // The level after the current one still comes next, so the index steps back over what was removed
+            if (i < ctx.current_level || (i == ctx.current_level && i > 0))
+                ctx.current_level--;
+            else if (i == ctx.current_level)
+                ctx.current_level = catalog.sources.size() - 1;
+
+            journal::info("Level '%1' removed", name);
+        }
+
+        if (!dropped)
+            return;
+
+        // A preload in flight has an index from before, its result is ignored
+        catalog.preload.reset();
+        game::preload_level(ctx, (ctx.current_level + 1) % catalog.sources.size());
+    }
+
+    static auto reload_levels(game::context_t &ctx, context_t &hr) -> void {
+        // Keeps running on the old state until the file reads again
+        const auto levels = read_levels(hr.levels_path);
+        if (!levels)
+            return;
+
+        std::set<std::string> playable;
+
+        for (const auto &level : levels.value()) {
+            const auto &name = level.name;
+            if (level.enable && level.has_data)
+                playable.insert(name);
+
+            const auto hash = get_level_hash(level);
+            if (hr.levels[name] == hash)
+                continue;
+
+            hr.levels[name] = hash;
+
+            if (!level.enable || !level.has_data)
+                continue;
+
+            auto source = game::make_level_source(name, level.width, level.height, level.tiles);
+
+            // Same layout as game::start, levels fill the upper half of the window
+            auto rebuilt = game::create_level(ctx, source, static_cast<uint32_t>(ctx.width), static_cast<uint32_t>(ctx.height * 0.5f));
+            if (!rebuilt) {
+                journal::error("Level '%1' not rebuilt", name);
+                continue;
+            }
+
+            auto &catalog = ctx.levels;
+            auto it = std::find_if(catalog.sources.begin(), catalog.sources.end(), [&name] (const auto &s) {
+                return s.name == name;
+            });
+
+            if (it == catalog.sources.end()) {
+                catalog.sources.push_back(std::move(source));
+                catalog.built.push_back(std::make_shared<const game::level_t>(std::move(rebuilt.value())));
+                journal::info("Level '%1' added", name);
+                continue;
+            }
+
+            // Session may still reference the old geometry, it is freed once nothing does
+            const auto index = static_cast<size_t>(it - catalog.sources.begin());
+            *it = std::move(source);
+            catalog.built[index] = std::make_shared<const game::level_t>(std::move(rebuilt.value()));
+
+            // Playing level restarts with the new layout, ball and paddle carry on
+            if (ctx.level.level && ctx.level.level->name == name)
+                game::enter_level(ctx.level, catalog.built[index]);
+
+            journal::info("Level '%1' rebuilt", name);
+        }
+
+        drop_levels(ctx, playable);
+    }
+
+    static auto reload_texture_files(game::context_t &ctx, context_t &hr, const std::set<std::string> &paths) -> void {
+        for (const auto &path : paths) {
+            const auto relative = fs::path{path}.lexically_relative(hr.assets_dir);
+            if (relative.empty() || *relative.begin() == "..")
+                continue;
+
+            // DDS copies made by texture_compressor belong to the texture of the same stem
+            auto stem = relative;
+            stem.replace_extension();
+
+            for (auto &entry : ctx.textures.entries) {
+                auto source = fs::path{entry.source};
+                source.replace_extension();
+
+                if (source.generic_string() != stem.generic_string())
+                    continue;
+
+                resources::invalidate_texture(ctx.textures, entry.texture.handle);
+                journal::info("Texture '%1' reloaded from '%2'", entry.name, relative.generic_string());
+            }
+        }
+    }
+
+    auto update(game::context_t &ctx, video::context_t &gtx, context_t &hr) -> void {
+        if (hr.fd < 0)
+            return;
+
+        // Several events per save are usual, collect them and act once per path
+        std::set<std::string> changed;
+        auto overflowed = false;
+
+        alignas(inotify_event) char buffer[4096];
+        while (true) {
+            const auto len = read(hr.fd, buffer, sizeof buffer);
+            if (len <= 0)
+                break;
+
+            for (auto p = buffer; p < buffer + len;) {
+                const auto ev = reinterpret_cast<const inotify_event*>(p);
+                p += sizeof(inotify_event) + ev->len;
+
+                if (ev->mask & IN_Q_OVERFLOW) {
+                    overflowed = true;
+                    continue;
+                }
+
+                const auto dir = hr.dirs.find(ev->wd);
+                if (dir == hr.dirs.end() || ev->len == 0)
+                    continue;
+
+                const auto path = (fs::path{dir->second} / ev->name).lexically_normal().string();
+
+                if (ev->mask & IN_ISDIR) {
+                    if (path.compare(0, hr.assets_dir.size(), hr.assets_dir) == 0)
+                        add_watch_recursive(hr, path);
+                    continue;
+                }
+
+                if (ev->mask & (IN_CLOSE_WRITE | IN_MOVED_TO))
+                    changed.insert(path);
+            }
+        }
+
+        // Events were dropped, so nothing says what changed and everything is checked against what is running
+        if (overflowed) {
+            journal::warning("%1", "Too many file changes at once, reloading everything");
+
+            add_watch_recursive(hr, hr.assets_dir);
+            reload_assets(ctx, gtx, hr);
+            reload_levels(ctx, hr);
+
+            for (auto &entry : ctx.textures.entries)
+                resources::invalidate_texture(ctx.textures, entry.texture.handle);
+
+            return;
+        }
+
+        if (changed.empty())
+            return;
+
+        if (changed.count(hr.assets_path))
+            reload_assets(ctx, gtx, hr);
+
+        if (changed.count(hr.levels_path))
+            reload_levels(ctx, hr);
+
+        reload_texture_files(ctx, hr, changed);
+    }
+
+    auto cleanup(context_t &hr) -> void {
+        if (hr.fd >= 0)
+            close(hr.fd);
+
+        hr = context_t{};
+    }
+
+} // namespace hot_reload
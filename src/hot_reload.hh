@@ -0,0 +1,45 @@
+#pragma once
+
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <unordered_map>
+
+namespace game {
+
+    struct context_type;
+    typedef context_type context_t;
+
+} // namespace game
+
+namespace video {
+
+    struct context_type;
+    typedef context_type context_t;
+
+} // namespace video
+
+namespace hot_reload {
+
+    typedef struct context_type {
+        context_type() = default;
+
+        int fd = -1;
+        std::unordered_map<int, std::string> dirs;
+
+        std::string assets_path;
+        std::string levels_path;
+        std::string assets_dir;
+
+        // Hashes of what is running now, only entries whose hash changes are rebuilt
+        std::unordered_map<std::string, uint64_t> programs;
+        std::unordered_map<std::string, uint64_t> levels;
+    } context_t;
+
+    auto init(game::context_t &ctx, const std::string_view assets_path, const std::string_view levels_path, const std::string_view assets_dir) -> std::optional<context_t>;
+
+    // Non-blocking, applies whatever changed on disk since the last call
+    auto update(game::context_t &ctx, video::context_t &gtx, context_t &hr) -> void;
+    auto cleanup(context_t &hr) -> void;
+
+} // namespace hot_reload
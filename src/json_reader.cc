@@ -0,0 +1,281 @@
+#include <cstdlib>
+#include <cstring>
+#include <cerrno>
+
+#include "json_reader.hh"
+
+static auto skip_whitespace(json_reader_t &r) -> void {
+    while (r.pos < r.end && (*r.pos == ' ' || *r.pos == '\n' || *r.pos == '\r' || *r.pos == '\t'))
+        r.pos++;
+}
+
+auto json_fail(json_reader_t &r, const std::string_view what) -> bool {
+    // First error wins, callers unwinding after it must not overwrite the cause
+    if (r.error.empty())
+        r.error = what;
+
+    return false;
+}
+
+auto json_peek(json_reader_t &r) -> char {
+    skip_whitespace(r);
+    return r.pos < r.end ? *r.pos : '\0';
+}
+
+auto json_next(json_reader_t &r) -> char {
+    skip_whitespace(r);
+    return r.pos < r.end ? *r.pos++ : '\0';
+}
+
+auto json_expect(json_reader_t &r, const char c) -> bool {
+    if (json_next(r) == c)
+        return true;
+
+    const char what[] = {'e', 'x', 'p', 'e', 'c', 't', 'e', 'd', ' ', '\'', c, '\'', '\0'};
+    return json_fail(r, what);
+}
+
+static auto hex_value(const char c) -> int {
+    if (c >= '0' && c <= '9')
+        return c - '0';
+    if (c >= 'a' && c <= 'f')
+        return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F')
+        return c - 'A' + 10;
+
+    return -1;
+}
+
+static auto read_hex4(json_reader_t &r, uint32_t &value) -> bool {
+    if (r.end - r.pos < 4)
+        return json_fail(r, "truncated \\u escape");
+
+    value = 0;
+    for (int i = 0; i < 4; i++) {
+        const auto v = hex_value(*r.pos++);
+        if (v < 0)
+            return json_fail(r, "bad \\u escape");
+
+        value = value << 4 | static_cast<uint32_t>(v);
+    }
+
+    return true;
+}
+
+static auto append_utf8(std::string &out, const uint32_t cp) -> void {
+    if (cp < 0x80) {
+        out += static_cast<char>(cp);
+    } else if (cp < 0x800) {
+        out += static_cast<char>(0xc0 | (cp >> 6));
+        out += static_cast<char>(0x80 | (cp & 0x3f));
+    } else if (cp < 0x10000) {
+        out += static_cast<char>(0xe0 | (cp >> 12));
+        out += static_cast<char>(0x80 | ((cp >> 6) & 0x3f));
+        out += static_cast<char>(0x80 | (cp & 0x3f));
+    } else {
+        out += static_cast<char>(0xf0 | (cp >> 18));
+        out += static_cast<char>(0x80 | ((cp >> 12) & 0x3f));
+        out += static_cast<char>(0x80 | ((cp >> 6) & 0x3f));
+        out += static_cast<char>(0x80 | (cp & 0x3f));
+    }
+}
+
+auto json_read_string(json_reader_t &r, std::string_view &value) -> bool {
+    if (!json_expect(r, '"'))
+        return false;
+
+    // Strings without escapes are returned as views into the text, no copy
+    const auto start = r.pos;
+    while (r.pos < r.end && *r.pos != '"' && *r.pos != '\\')
+        r.pos++;
+
+    if (r.pos >= r.end)
+        return json_fail(r, "unterminated string");
+
+    if (*r.pos == '"') {
+        value = std::string_view{start, static_cast<size_t>(r.pos - start)};
+        r.pos++;
+        return true;
+    }
+
+    r.scratch.assign(start, r.pos);
+
+    while (r.pos < r.end && *r.pos != '"') {
+        if (*r.pos != '\\') {
+            r.scratch += *r.pos++;
+            continue;
+        }
+
+        if (++r.pos >= r.end)
+            return json_fail(r, "unterminated string");
+
+        switch (*r.pos++) {
+        case '"': r.scratch += '"'; break;
+        case '\\': r.scratch += '\\'; break;
+        case '/': r.scratch += '/'; break;
+        case 'b': r.scratch += '\b'; break;
+        case 'f': r.scratch += '\f'; break;
+        case 'n': r.scratch += '\n'; break;
+        case 'r': r.scratch += '\r'; break;
+        case 't': r.scratch += '\t'; break;
+        case 'u': {
+            uint32_t cp = 0;
+            if (!read_hex4(r, cp))
+                return false;
+
+            // Surrogate pair encodes one code point above the BMP
+            if (cp >= 0xd800 && cp <= 0xdbff) {
+                uint32_t low = 0;
+                if (r.end - r.pos < 2 || r.pos[0] != '\\' || r.pos[1] != 'u')
+                    return json_fail(r, "unpaired surrogate");
+
+                r.pos += 2;
+                if (!read_hex4(r, low) || low < 0xdc00 || low > 0xdfff)
+                    return json_fail(r, "unpaired surrogate");
+
+                cp = 0x10000 + ((cp - 0xd800) << 10) + (low - 0xdc00);
+            }
+
+            append_utf8(r.scratch, cp);
+            break;
+        }
+        default:
+            return json_fail(r, "bad escape");
+        }
+    }
+
+    if (r.pos >= r.end)
+        return json_fail(r, "unterminated string");
+
+    r.pos++;
+    value = r.scratch;
+
+    return true;
+}
+
+auto json_read_string(json_reader_t &r, std::string &value) -> bool {
+    std::string_view view;
+    if (!json_read_string(r, view))
+        return false;
+
+    value.assign(view.data(), view.size());
+    return true;
+}
+
+auto json_read_bool(json_reader_t &r, bool &value) -> bool {
+    skip_whitespace(r);
+
+    const auto left = static_cast<size_t>(r.end - r.pos);
+    if (left >= 4 && memcmp(r.pos, "true", 4) == 0) {
+        r.pos += 4;
+        value = true;
+        return true;
+    }
+
+    if (left >= 5 && memcmp(r.pos, "false", 5) == 0) {
+        r.pos += 5;
+        value = false;
+        return true;
+    }
+
+    return json_fail(r, "expected boolean");
+}
+
+auto json_read_int(json_reader_t &r, int64_t &value) -> bool {
+    skip_whitespace(r);
+
+    // Hand rolled, tile arrays are millions of small integers and strtoll needs a terminated copy
+    auto p = r.pos;
+    const auto negative = p < r.end && *p == '-';
+    if (negative)
+        p++;
+
+    if (p >= r.end || *p < '0' || *p > '9')
+        return json_fail(r, "expected integer");
+
+    uint64_t v = 0;
+    for (; p < r.end && *p >= '0' && *p <= '9'; p++) {
+        if (v > (UINT64_MAX - 9) / 10)
+            return json_fail(r, "integer overflow");
+
+        v = v * 10 + static_cast<uint64_t>(*p - '0');
+    }
+
+    if (p < r.end && (*p == '.' || *p == 'e' || *p == 'E'))
+        return json_fail(r, "expected integer, got fraction");
+
+    r.pos = p;
+    value = negative ? -static_cast<int64_t>(v) : static_cast<int64_t>(v);
+
+    return true;
+}
+
+auto json_read_double(json_reader_t &r, double &value) -> bool {
+    skip_whitespace(r);
+
+    auto p = r.pos;
+    while (p < r.end && (strchr("+-.eE", *p) || (*p >= '0' && *p <= '9')))
+        p++;
+
+    if (p == r.pos)
+        return json_fail(r, "expected number");
+
+    const std::string number{r.pos, p};
+    char *parsed_end = nullptr;
+    errno = 0;
+    value = strtod(number.c_str(), &parsed_end);
+
+    if (errno != 0 || parsed_end != number.c_str() + number.size())
+        return json_fail(r, "bad number");
+
+    r.pos = p;
+
+    return true;
+}
+
+auto json_skip_value(json_reader_t &r) -> bool {
+    switch (json_peek(r)) {
+    case '{':
+        return json_read_object(r, [&r] (std::string_view) {
+            return json_skip_value(r);
+        });
+    case '[':
+        return json_read_array(r, [&r] {
+            return json_skip_value(r);
+        });
+    case '"': {
+        std::string_view ignored;
+        return json_read_string(r, ignored);
+    }
+    case 't':
+    case 'f': {
+        bool ignored = false;
+        return json_read_bool(r, ignored);
+    }
+    case 'n':
+        if (r.end - r.pos >= 4 && memcmp(r.pos, "null", 4) == 0) {
+            r.pos += 4;
+            return true;
+        }
+
+        return json_fail(r, "expected null");
+    default: {
+        double ignored = 0;
+        return json_read_double(r, ignored);
+    }
+    }
+}
+
+auto json_get_location(const json_reader_t &r) -> std::pair<size_t, size_t> {
+    size_t line = 1, column = 1;
+    for (auto p = r.begin; p < r.pos && p < r.end; p++) {
+        if (*p == '\n') {
+            line++;
+            column = 1;
+        } else {
+            column++;
+        }
+    }
+
+    return {line, column};
+}
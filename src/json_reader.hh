@@ -0,0 +1,108 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <string>
+#include <string_view>
+
+// Streaming reader over a JSON text, values go straight into the caller's structures without a DOM
+
+typedef struct json_reader_type {
+    json_reader_type() = default;
+    json_reader_type(const std::string_view text) : begin{text.data()}, pos{text.data()}, end{text.data() + text.size()} {}
+
+    const char *begin = nullptr;
+    const char *pos = nullptr;
+    const char *end = nullptr;
+
+    // Holds decoded strings that had escapes, views returned by read_string point here or into the text
+    std::string scratch;
+    std::string error;
+} json_reader_t;
+
+auto json_fail(json_reader_t &r, const std::string_view what) -> bool;
+auto json_peek(json_reader_t &r) -> char;
+auto json_next(json_reader_t &r) -> char;
+auto json_expect(json_reader_t &r, const char c) -> bool;
+
+auto json_read_string(json_reader_t &r, std::string_view &value) -> bool;
+auto json_read_string(json_reader_t &r, std::string &value) -> bool;
+auto json_read_bool(json_reader_t &r, bool &value) -> bool;
+auto json_read_int(json_reader_t &r, int64_t &value) -> bool;
+auto json_read_double(json_reader_t &r, double &value) -> bool;
+auto json_skip_value(json_reader_t &r) -> bool;
+
+// Line and column of the current position, for error messages
+auto json_get_location(const json_reader_t &r) -> std::pair<size_t, size_t>;
+
+template<typename T>
+inline auto json_read_int(json_reader_t &r, T &value) -> bool {
+    int64_t v = 0;
+    if (!json_read_int(r, v))
+        return false;
+
+    value = static_cast<T>(v);
+    return true;
+}
+
+// Calls fn(key) for every member, fn reads or skips the value and returns false to stop
+template<typename Fn>
+inline auto json_read_object(json_reader_t &r, Fn &&fn) -> bool {
+    if (!json_expect(r, '{'))
+        return false;
+
+    if (json_peek(r) == '}') {
+        r.pos++;
+        return true;
+    }
+
+    while (true) {
+        std::string_view key;
+        if (!json_read_string(r, key))
+            return false;
+
+        // Key may live in scratch, which the value read can overwrite
+        const std::string owned_key = r.scratch.data() == key.data() ? std::string{key} : std::string{};
+        if (!owned_key.empty())
+            key = owned_key;
+
+        if (!json_expect(r, ':'))
+            return false;
+
+        if (!fn(key))
+            return false;
+
+        const auto c = json_next(r);
+
+        if (c == '}')
+            return true;
+
+        if (c != ',')
+            return json_fail(r, "expected ',' or '}'");
+    }
+}
+
+// Calls fn() for every element, fn reads or skips it and returns false to stop
+template<typename Fn>
+inline auto json_read_array(json_reader_t &r, Fn &&fn) -> bool {
+    if (!json_expect(r, '['))
+        return false;
+
+    if (json_peek(r) == ']') {
+        r.pos++;
+        return true;
+    }
+
+    while (true) {
+        if (!fn())
+            return false;
+
+        const auto c = json_next(r);
+
+        if (c == ']')
+            return true;
+
+        if (c != ',')
+            return json_fail(r, "expected ',' or ']'");
+    }
+}
@@ -0,0 +1,39 @@
+#include <algorithm>
+
+#include "journal.hh"
+#include "latency_probe.hh"
+
+namespace audio {
+
+    auto collect_latency(latency_probe_t &probe) -> void {
+        uint32_t us = 0;
+        while (pop(probe.measured, us)) {
+            if (probe.samples.size() < LATENCY_MAX_SAMPLES)
+                probe.samples.push_back(us);
+            else
+                probe.dropped++;
+        }
+    }
+
+    auto report_latency(latency_probe_t &probe, const int buffer_frames, const int frequency) -> void {
+        collect_latency(probe);
+
+        auto &samples = probe.samples;
+        if (samples.empty())
+            return;
+
+        std::sort(samples.begin(), samples.end());
+
+        const auto percentile = [&samples] (const float p) {
+            const auto index = static_cast<size_t>(p * static_cast<float>(samples.size() - 1) + 0.5f);
+            return static_cast<double>(samples[index]) / 1000.0;
+        };
+
+        const auto buffer_ms = frequency > 0 ? static_cast<double>(buffer_frames) * 1000.0 / frequency : 0.0;
+
+        journal::info("Sound latency ms over %1 plays: min %2 p50 %3 p90 %4 p99 %5 max %6", samples.size() + probe.dropped,
+                      percentile(0.0f), percentile(0.5f), percentile(0.9f), percentile(0.99f), percentile(1.0f));
+        journal::info("Device buffer of %1 frames adds %2 ms, about %3 ms end to end at p50", buffer_frames, buffer_ms, percentile(0.5f) + buffer_ms);
+    }
+
+} // namespace audio
@@ -0,0 +1,51 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <chrono>
+#include <vector>
+
+#include "spsc_queue.hh"
+
+// Time from play_sound to the callback that first mixes the sound, measured on the audio thread
+
+namespace audio {
+
+    constexpr size_t LATENCY_QUEUE = 256;
+    constexpr size_t LATENCY_MAX_SAMPLES = 1 << 16; // kept for the report, later plays are only counted
+
+    typedef struct latency_probe_type {
+        latency_probe_type() = default;
+
+        spsc_queue_t<uint64_t, LATENCY_QUEUE> issued; // play times, for backends that start sounds outside the callback
+        spsc_queue_t<uint32_t, LATENCY_QUEUE> measured; // microseconds, handed back to the game thread
+
+        // Game thread only
+        std::vector<uint32_t> samples;
+        uint64_t dropped = 0;
+    } latency_probe_t;
+
+    inline auto probe_now() -> uint64_t {
+        return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count());
+    }
+
+    // Audio thread, a full queue loses the sample rather than wait
+    inline auto record_latency(latency_probe_t &probe, const uint64_t issued_ns, const uint64_t mixed_ns) -> void {
+        const auto us = mixed_ns > issued_ns ? (mixed_ns - issued_ns) / 1000 : 0;
+        push(probe.measured, static_cast<uint32_t>(us < UINT32_MAX ? us : UINT32_MAX));
+    }
+
+    // Audio thread, every sound issued so far is in the block just mixed
+    inline auto record_issued_latency(latency_probe_t &probe, const uint64_t mixed_ns) -> void {
+        uint64_t issued = 0;
+        while (pop(probe.issued, issued))
+            record_latency(probe, issued, mixed_ns);
+    }
+
+    // Game thread, once per frame
+    auto collect_latency(latency_probe_t &probe) -> void;
+
+    // Logs the distribution, the device buffer is played after the callback so it adds on top
+    auto report_latency(latency_probe_t &probe, const int buffer_frames, const int frequency) -> void;
+
+} // namespace audio
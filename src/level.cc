@@ -1,11 +1,15 @@
-#include <json.hpp>
+#include <cstring>
+#include <algorithm>
 
 #include "game.hh"
 #include "journal.hh"
+#include "mapped_file.hh"
+#include "level_format.hh"
+#include "manifest.hh"
+#include "worker_pool.hh"
+#include "trace.hh"
 #include "level.hh"
 
-using json = nlohmann::json;
-
 namespace game {
     using glm::vec2;
     using glm::vec3;
@@ -19,12 +23,16 @@ namespace game {
         TILE_4 = 5
     };
 
-    auto create_level(context_t &ctx, const std::string_view name, const std::vector<std::vector<uint8_t>> &tiles, const uint32_t level_w, const uint32_t level_h) -> std::optional<level_t> {
-        if (tiles.empty())
-            return {};
+    // Touches no shared state, textures are resolved by the caller so this runs on any thread
+    static auto build_level(const level_source_t &source, const resources::texture_t &block, const resources::texture_t &block_solid, const uint32_t level_w, const uint32_t level_h) -> std::optional<level_t> {
+        const trace::scope_t scope{source.name};
 
-        const auto height = tiles.size();
-        const auto width = tiles[0].size();
+        const auto tiles = source.tiles;
+        const auto width = source.width;
+        const auto height = source.height;
+
+        if (!tiles)
+            return {};
 
         if (height == 0)
             return {};
@@ -33,26 +41,26 @@ namespace game {
             return {};
 
         level_t level;
-        level.name = name;
+        level.name = source.name;
 
         const auto unit_width = static_cast<float>(level_w) / static_cast<float>(width);
         const auto unit_height = static_cast<float>(level_h) / height;
 
         for (size_t y = 0; y < height; ++y) {
             for (size_t x = 0; x < width; ++x) {
-                if (tiles[y][x] == SOLID_TILE) {
+                if (tiles[y * width + x] == SOLID_TILE) {
                     const auto pos = vec2{unit_width * x, unit_height * y};
                     const auto size = vec2{unit_width, unit_height} * 0.995f;
 
                     object obj;
-                    obj.texture = resources::get_texture(ctx, "block_solid").value_or(resources::texture_t{});
+                    obj.texture = block_solid;
                     obj.position = pos;
                     obj.size = size;
                     obj.color = vec3{0.8f, 0.8f, 0.7f};
                     obj.is_solid = true;
 
                     level.bricks.push_back(obj);
-                } else if (tiles[y][x] > 1) {
+                } else if (tiles[y * width + x] > 1) {
                     const auto get_color = [] (const auto value) {
                         if (value == TILE_1)
                             return vec3{0.2f, 0.6f, 1.0f};
@@ -70,12 +78,13 @@ namespace game {
                     const auto size = vec2{unit_width, unit_height} * 0.995f;
 
                     object obj;
-                    obj.texture = resources::get_texture(ctx, "block").value_or(resources::texture_t{});
+                    obj.texture = block;
                     obj.position = pos;
                     obj.size = size;
-                    obj.color = get_color(tiles[y][x]);
+                    obj.color = get_color(tiles[y * width + x]);
 
                     level.bricks.push_back(obj);
+                    level.breakable++;
                 }
             }
         }
@@ -83,47 +92,210 @@ namespace game {
         return level;
     }
 
-    auto load_levels(context_t &ctx, const std::string_view levels_path, const uint32_t level_w, const uint32_t level_h) -> std::vector<level_t> {
-        using namespace std;
+    auto create_level(context_t &ctx, const level_source_t &source, const uint32_t level_w, const uint32_t level_h) -> std::optional<level_t> {
+        const auto block = resources::get_texture(ctx, "block").value_or(resources::texture_t{});
+        const auto block_solid = resources::get_texture(ctx, "block_solid").value_or(resources::texture_t{});
 
-        auto contents = get_config(levels_path);
-        if (!contents) {
-            journal::critical("%1", "Can't read levels config");
+        return build_level(source, block, block_solid, level_w, level_h);
+    }
+
+    auto make_level_source(const std::string_view name, const size_t width, const size_t height, std::vector<uint8_t> tiles) -> level_source_t {
+        auto storage = std::make_shared<const std::vector<uint8_t>>(std::move(tiles));
+
+        level_source_t source;
+        source.name = name;
+        source.width = width;
+        source.height = height;
+        source.tiles = storage->data();
+        source.storage = std::move(storage);
+
+        return source;
+    }
+
+    auto enter_level(level_state_t &state, std::shared_ptr<const level_t> level) -> void {
+        const auto count = level ? level->bricks.size() : 0;
+
+        state.remaining = level ? level->breakable : 0;
+        state.level = std::move(level);
+        state.destroyed.assign((count + 63) / 64, 0);
+    }
+
+    auto reset_level(level_state_t &state) -> void {
+        std::fill(state.destroyed.begin(), state.destroyed.end(), 0);
+        state.remaining = state.level ? state.level->breakable : 0;
+    }
+
+    // Hash of the JSON as the level compiler saw it, zero when it can't be read
+    static auto levels_hash(const std::string_view levels_path) -> uint64_t {
+        auto file = resources::map_file(levels_path);
+        if (!file)
+            return 0;
+
+        const auto hash = hash_fnv1a(file.value().data, file.value().size);
+        resources::unmap_file(file.value());
+
+        return hash;
+    }
+
+    auto load_level_pack(const std::string_view pack_path, const std::string_view levels_path, resources::mapped_file_t &pack) -> std::vector<level_source_t> {
+        auto file = resources::map_file(pack_path);
+        if (!file)
             return {};
-        }
 
-        auto j = json::parse(contents.value());
+        const auto data = file.value().data;
+        const auto size = file.value().size;
+        const auto header = reinterpret_cast<const LEVEL_PACK_HEADER*>(data);
+
+        const auto valid = size >= sizeof(LEVEL_PACK_HEADER)
+                && memcmp(header->magic, LEVEL_PACK_MAGIC, sizeof header->magic) == 0
+                && header->version == LEVEL_PACK_VERSION
+                && header->index_offset + static_cast<uint64_t>(header->count) * sizeof(LEVEL_PACK_ENTRY) <= size
+                && header->names_offset + header->names_size <= size
+                && header->tiles_offset + header->tiles_size <= size;
+
+        if (!valid) {
+            journal::error("Invalid level pack '%1'", pack_path);
+            resources::unmap_file(file.value());
+            return {};
+        }
 
-        if (j.find("levels") == j.end())
+        // Without the JSON there is nothing newer to fall back to, so the pack is used as is
+        const auto source_hash = levels_hash(levels_path);
+        if (source_hash != 0 && source_hash != header->source_hash) {
+            journal::info("Level pack '%1' is older than '%2', loading the JSON", pack_path, levels_path);
+            resources::unmap_file(file.value());
             return {};
+        }
 
-        vector<level_t> all_levels;
+        const auto entries = reinterpret_cast<const LEVEL_PACK_ENTRY*>(data + header->index_offset);
+        const auto names = reinterpret_cast<const char*>(data + header->names_offset);
+        const auto tiles = data + header->tiles_offset;
 
-        for (auto& level : j["levels"]) {
-            const auto name = level.find("name") != level.end() ? level["name"].get<string>() : string{};
-            const auto enable = level.find("enable") != level.end() ? level["enable"].get<bool>() : false;
+        std::vector<level_source_t> sources;
 
-            if (!enable)
+        // Tiles stay in the mapping, which lives as long as the catalog
+        for (uint32_t i = 0; i < header->count; i++) {
+            const auto &entry = entries[i];
+            if (!(entry.flags & LEVEL_ENABLED))
                 continue;
 
-            if (level.find("data") != level.end()) {
-                vector<vector<uint8_t>> tiles;
+            const auto name = std::string_view{names + entry.name_offset, entry.name_size};
 
-                for (auto& d : level["data"]) {
-                    const auto line = d.get<vector<uint8_t>>();
-                    tiles.push_back(line);
-                }
+            if (entry.name_offset + static_cast<uint64_t>(entry.name_size) > header->names_size
+                    || entry.tiles_offset + static_cast<uint64_t>(entry.width) * entry.height > header->tiles_size) {
+                journal::warning("Level '%1' is out of pack bounds", name);
+                continue;
+            }
 
-                if (const auto l = create_level(ctx, name, tiles, level_w, level_h); l) {
-                    journal::info("Level '%1' loaded", name);
-                    all_levels.push_back(l.value());
-                }
+            level_source_t source;
+            source.name = name;
+            source.width = entry.width;
+            source.height = entry.height;
+            source.tiles = tiles + entry.tiles_offset;
+            sources.push_back(std::move(source));
+        }
+
+        if (sources.empty())
+            resources::unmap_file(file.value());
+        else
+            pack = file.value();
+
+        return sources;
+    }
+
+    auto load_levels(const std::string_view levels_path) -> std::vector<level_source_t> {
+        auto file = resources::map_file(levels_path);
+        if (!file) {
+            journal::critical("%1", "Can't read levels config");
+            return {};
+        }
 
-            } else {
-                journal::warning("Data for level '%1' not found!", name);
+        std::vector<level_source_t> sources;
+
+        manifest::read_levels({reinterpret_cast<const char*>(file.value().data), file.value().size}, levels_path, [&] (const manifest::level_t &level) {
+            if (!level.enable)
+                return;
+
+            if (!level.has_data) {
+                journal::warning("Data for level '%1' not found!", level.name);
+                return;
             }
+
+            sources.push_back(make_level_source(level.name, level.width, level.height, level.tiles));
+        });
+
+        resources::unmap_file(file.value());
+
+        return sources;
+    }
+
+    // Levels fill the upper half of the window
+    static auto get_level_area(const context_t &ctx) -> std::pair<uint32_t, uint32_t> {
+        return {static_cast<uint32_t>(ctx.width), static_cast<uint32_t>(ctx.height * 0.5f)};
+    }
+
+    auto instantiate_level(context_t &ctx, const size_t index) -> std::shared_ptr<const level_t> {
+        auto &catalog = ctx.levels;
+
+        poll_level_preload(ctx);
+
+        if (catalog.built[index])
+            return catalog.built[index];
+
+        // Preload is late or was never asked for, building here costs this frame
+        const auto [level_w, level_h] = get_level_area(ctx);
+        if (auto level = create_level(ctx, catalog.sources[index], level_w, level_h); level) {
+            journal::info("Level '%1' loaded", level.value().name);
+            catalog.built[index] = std::make_shared<const level_t>(std::move(level.value()));
         }
 
-        return all_levels;
+        return catalog.built[index];
+    }
+
+    auto preload_level(context_t &ctx, const size_t index) -> void {
+        auto &catalog = ctx.levels;
+
+        if (index >= catalog.sources.size() || catalog.built[index] || !ctx.workers)
+            return;
+
+        // Only one level ahead is ever needed, an unfinished older preload just gets ignored
+        auto preload = std::make_shared<level_preload_t>();
+        preload->index = index;
+        catalog.preload = preload;
+
+        const auto [level_w, level_h] = get_level_area(ctx);
+        const auto block = resources::get_texture(ctx, "block").value_or(resources::texture_t{});
+        const auto block_solid = resources::get_texture(ctx, "block_solid").value_or(resources::texture_t{});
+
+        workers::submit(*ctx.workers, [preload, source = catalog.sources[index], block, block_solid, level_w = level_w, level_h = level_h] {
+            if (auto level = build_level(source, block, block_solid, level_w, level_h); level)
+                preload->level = std::make_shared<const level_t>(std::move(level.value()));
+
+            preload->done.store(true, std::memory_order_release);
+        });
+    }
+
+    auto poll_level_preload(context_t &ctx) -> void {
+        auto &catalog = ctx.levels;
+
+        if (!catalog.preload || !catalog.preload->done.load(std::memory_order_acquire))
+            return;
+
+        const auto preload = std::move(catalog.preload);
+
+        // A reload may have rebuilt the level meanwhile, that one is newer
+        if (preload->index < catalog.built.size() && !catalog.built[preload->index] && preload->level) {
+            journal::info("Level '%1' preloaded", preload->level->name);
+            catalog.built[preload->index] = preload->level;
+        }
+    }
+
+    auto cleanup_levels(level_catalog_t &catalog) -> void {
+        catalog.preload.reset();
+        catalog.built.clear();
+        catalog.sources.clear();
+
+        resources::unmap_file(catalog.pack);
+        catalog.pack = resources::mapped_file_t{};
     }
 } // namespace game
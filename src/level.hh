@@ -1,9 +1,15 @@
 #pragma once
 
+#include <cstdint>
+#include <cstddef>
 #include <vector>
+#include <memory>
+#include <atomic>
 #include <string>
 #include <optional>
 
+#include "mapped_file.hh"
+
 namespace game {
 
     struct context_type;
@@ -18,9 +24,83 @@ namespace game {
         bool is_complited = false;
 
         std::vector<object> bricks;
+        size_t breakable = 0;
     } level_t;
 
-    auto create_level(context_t &ctx, const std::string_view name, const std::vector<std::vector<uint8_t>> &tiles, const uint32_t level_w, const uint32_t level_h) -> std::optional<level_t>;
-    auto load_levels(context_t &ctx, const std::string_view levels_path, const uint32_t level_w, const uint32_t level_h) -> std::vector<level_t>;
+    // Tile layout of a level that has not been built yet, cheap to keep for every level
+    typedef struct level_source_type {
+        level_source_type() = default;
+
+        std::string name;
+        size_t width = 0;
+        size_t height = 0;
+
+        // Points into the mapped level pack or into storage, which is shared so a worker can outlive a reload
+        const uint8_t *tiles = nullptr;
+        std::shared_ptr<const std::vector<uint8_t>> storage;
+    } level_source_t;
+
+    // Geometry is shared and never written after load, only this per-session state changes
+    typedef struct level_state_type {
+        level_state_type() = default;
+
+        std::shared_ptr<const level_t> level;
+        std::vector<uint64_t> destroyed; // one bit per brick
+        size_t remaining = 0; // breakable bricks left
+    } level_state_t;
+
+    // Written by a worker, picked up by the main thread once done is set
+    typedef struct level_preload_type {
+        level_preload_type() = default;
+
+        size_t index = 0;
+        std::shared_ptr<const level_t> level;
+        std::atomic<bool> done{false};
+    } level_preload_t;
+
+    typedef struct level_catalog_type {
+        level_catalog_type() = default;
+
+        std::vector<level_source_t> sources;
+        std::vector<std::shared_ptr<const level_t>> built; // empty until instantiated
+        std::shared_ptr<level_preload_t> preload;
+        resources::mapped_file_t pack;
+    } level_catalog_t;
+
+    inline auto is_brick_destroyed(const level_state_t &state, const size_t brick) -> bool {
+        return state.destroyed[brick >> 6] & (uint64_t{1} << (brick & 63));
+    }
+
+    inline auto destroy_brick(level_state_t &state, const size_t brick) -> void {
+        state.destroyed[brick >> 6] |= uint64_t{1} << (brick & 63);
+        state.remaining--;
+    }
+
+    // Points the session at another level, geometry is referenced, not copied
+    auto enter_level(level_state_t &state, std::shared_ptr<const level_t> level) -> void;
+
+    // Brings every brick back, a single clear of the bitset
+    auto reset_level(level_state_t &state) -> void;
+
+    // Tiles row by row, as the level reader packs them
+    auto make_level_source(const std::string_view name, const size_t width, const size_t height, std::vector<uint8_t> tiles) -> level_source_t;
+
+    auto create_level(context_t &ctx, const level_source_t &source, const uint32_t level_w, const uint32_t level_h) -> std::optional<level_t>;
+
+    // Only the index and tile layouts are read, levels are built on first use.
+    // Empty when the pack was compiled from other contents than levels_path, so edits to the JSON aren't lost.
+    auto load_level_pack(const std::string_view pack_path, const std::string_view levels_path, resources::mapped_file_t &pack) -> std::vector<level_source_t>;
+    auto load_levels(const std::string_view levels_path) -> std::vector<level_source_t>;
+
+    // Built level for the index, taken from the cache or the finished preload, built in place otherwise
+    auto instantiate_level(context_t &ctx, const size_t index) -> std::shared_ptr<const level_t>;
+
+    // Builds the level on a worker while the current one is played
+    auto preload_level(context_t &ctx, const size_t index) -> void;
+
+    // Called once per tick, hands a finished preload over without blocking
+    auto poll_level_preload(context_t &ctx) -> void;
+
+    auto cleanup_levels(level_catalog_t &catalog) -> void;
 
 } // namespace game
@@ -0,0 +1,39 @@
+#pragma once
+
+#include <cstdint>
+
+// Compiled levels: header, index in authoring order, names, then one byte per tile row by row
+
+constexpr char LEVEL_PACK_MAGIC[4] = {'A', 'R', 'K', 'L'};
+constexpr uint32_t LEVEL_PACK_VERSION = 2;
+
+enum LEVEL_FLAGS : uint32_t {
+    LEVEL_ENABLED = 1 << 0
+};
+
+#pragma pack(push, level_pack_align)
+#pragma pack(1)
+typedef struct LevelPackHeader
+{
+    char        magic[4];
+    uint32_t    version;
+    uint32_t    count;
+    uint32_t    names_size;
+    uint64_t    index_offset;
+    uint64_t    names_offset;
+    uint64_t    tiles_offset;
+    uint64_t    tiles_size;
+    uint64_t    source_hash;    // whole levels JSON file, a pack that doesn't match it is stale
+} LEVEL_PACK_HEADER;
+
+typedef struct LevelPackEntry
+{
+    uint32_t    name_offset;
+    uint32_t    name_size;
+    uint16_t    width;
+    uint16_t    height;
+    uint32_t    flags;
+    uint64_t    tiles_offset;   // from the start of tiles section
+    uint64_t    source_hash;    // level JSON it was compiled from
+} LEVEL_PACK_ENTRY;
+#pragma pack(pop, level_pack_align)
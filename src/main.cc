@@ -1,16 +1,280 @@
 #include <algorithm>
+#include <cctype>
+#include <cerrno>
+#include <cstdint>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <sstream>
+
+#include <GL/glcore.h>
 
 #include "config.hh"
 #include "audio.hh"
 #include "journal.hh"
 #include "video.hh"
 #include "game.hh"
+#include "headless.hh"
+#include "hot_reload.hh"
+#include "trace.hh"
+
+// Whole string has to be a decimal number, strtoul alone would take signs, spaces and trailing junk
+static auto parse_number(const std::string &text) -> std::optional<uint32_t> {
+    if (text.empty() || !isdigit(static_cast<unsigned char>(text.front())))
+        return {};
+
+    errno = 0;
+    char *end = nullptr;
+    const auto value = strtoul(text.c_str(), &end, 10);
+
+    if (errno != 0 || *end != '\0' || value > UINT32_MAX)
+        return {};
+
+    return static_cast<uint32_t>(value);
+}
+
+static auto parse_options(int argc, char *argv[]) -> std::optional<headless::options_t> {
+    headless::options_t opts;
+
+    for (int i = 1; i < argc; i++) {
+        const std::string_view arg = argv[i];
+        const auto has_value = i + 1 < argc;
+        auto valid = true;
+
+        if (arg == "--headless") {
+            opts.enabled = true;
+        } else if (arg == "--frames" && has_value) {
+            const auto frames = parse_number(argv[++i]);
+            valid = frames.has_value();
+            opts.frames = frames.value_or(opts.frames);
+        } else if (arg == "--dump" && has_value) {
+            std::istringstream ss{argv[++i]};
+            for (std::string text; valid && std::getline(ss, text, ',');) {
+                const auto frame = parse_number(text);
+                valid = frame.has_value();
+                if (frame)
+                    opts.dump_frames.push_back(frame.value());
+            }
+        } else if (arg == "--seed" && has_value) {
+            const auto seed = parse_number(argv[++i]);
+            valid = seed.has_value();
+            opts.seed = seed.value_or(opts.seed);
+        } else if (arg == "--output" && has_value) {
+            opts.output_dir = argv[++i];
+        } else if (arg == "--script" && has_value) {
+            opts.script_path = argv[++i];
+        } else if (arg == "--trace" && has_value) {
+            opts.trace_path = argv[++i];
+        } else if (arg == "--audio" && has_value) {
+            opts.audio_path = argv[++i];
+        } else {
+            valid = false;
+        }
+
+        if (!valid) {
+            if (arg.data() == argv[i])
+                journal::critical("Unknown option '%1'", arg);
+            else
+                journal::critical("Bad value '%1' for option '%2'", argv[i], arg);
+
+            journal::info("%1", "Usage: arkanoid [--trace FILE] [--headless [--frames N] [--dump F1,F2,...] [--output DIR] [--script FILE] [--seed N] [--audio FILE]]");
+            return {};
+        }
+    }
+
+    return opts;
+}
+
+#ifdef HEADLESS_MODE
+static auto load_session_script(const headless::options_t &opts) -> std::optional<std::vector<headless::script_event_t>> {
+    if (opts.script_path.empty())
+        return std::vector<headless::script_event_t>{};
+
+    return headless::load_script(opts.script_path);
+}
+
+// Script keys for this frame go in as SDL events, so the game can't tell them from a keyboard
+static auto push_script_events(std::vector<headless::script_event_t>::const_iterator &next_event, const std::vector<headless::script_event_t> &script, const uint32_t frame) -> void {
+    for (; next_event != script.end() && next_event->frame == frame; ++next_event) {
+        SDL_Event ev = {};
+        ev.type = next_event->pressed ? SDL_KEYDOWN : SDL_KEYUP;
+        ev.key.keysym.sym = next_event->key;
+        SDL_PushEvent(&ev);
+    }
+}
+
+// Fixed frame rate and scripted input make every run render the same frames
+static auto run_headless(game::context_t &app, audio::context_t &atx, video::context_t &gtx, const headless::options_t &opts) -> bool {
+    constexpr auto frame_time = 1.f / 60.f;
+
+    const auto script = load_session_script(opts);
+    if (!script)
+        return false;
+
+    seed_random(opts.seed);
+
+    std::vector<float> frame_times;
+    frame_times.reserve(opts.frames);
+
+    auto next_event = script.value().cbegin();
+    auto accumulator = 0.0f;
+    const auto freq = static_cast<double>(SDL_GetPerformanceFrequency());
+
+    for (uint32_t frame = 0; frame < opts.frames && app.running; frame++) {
+        push_script_events(next_event, script.value(), frame);
+
+        const auto start = SDL_GetPerformanceCounter();
+
+        game::process_events(app, frame_time);
+
+        accumulator += frame_time;
+        while (accumulator >= game::timestep) {
+            accumulator -= game::timestep;
+            game::update(app, game::timestep);
+        }
+
+        audio::flush_sounds(app, atx);
+        audio::update(atx);
+
+#ifdef SOFTWARE_MIXER_BACKEND
+        // Null device has no clock of its own, it is advanced by one frame of audio
+        audio::render(atx, static_cast<size_t>(static_cast<float>(atx.format.frequency) * frame_time));
+#endif // SOFTWARE_MIXER_BACKEND
+
+        resources::process_uploads(app, TEXTURE_UPLOAD_BUDGET);
+
+        game::draw(app, gtx);
+
+        auto projection = glm::ortho(0.0f, static_cast<float>(app.width), static_cast<float>(app.height), 0.0f, -1.0f, 1.0f);
+        auto view = glm::mat4{1.f};
+
+        gtx.options = app.render_options;
+        video::present(app.width, app.height, static_cast<float>(frame) * frame_time, gtx, projection, view);
+
+        // Wait for GPU, otherwise only submission time is measured
+        glFinish();
+
+        frame_times.push_back(static_cast<float>(static_cast<double>(SDL_GetPerformanceCounter() - start) * 1000.0 / freq));
+
+        if (std::find(opts.dump_frames.begin(), opts.dump_frames.end(), frame) != opts.dump_frames.end()) {
+            char name[64] = {};
+            snprintf(name, sizeof name, "/frame_%05u.tga", frame);
+
+            const auto path = opts.output_dir + name;
+            if (headless::save_frame(path, gtx.screen_fb, app.width, app.height))
+                journal::info("Frame %1 saved to '%2'", frame, path);
+        }
+    }
+
+    headless::report_frame_times(std::move(frame_times));
+
+    return true;
+}
+
+#ifdef SOFTWARE_MIXER_BACKEND
+// Same session as run_headless without drawing, the null device mixes up to each tick so its sounds start on that exact sample
+static auto render_audio(game::context_t &app, audio::context_t &atx, const headless::options_t &opts) -> bool {
+    constexpr auto frame_time = 1.f / 60.f;
+
+    const auto script = load_session_script(opts);
+    if (!script)
+        return false;
+
+    seed_random(opts.seed);
+
+    std::vector<int16_t> session;
+    const auto frequency = static_cast<double>(atx.format.frequency);
+    uint64_t ticks = 0;
+    size_t rendered = 0;
+
+    auto next_event = script.value().cbegin();
+    auto accumulator = 0.0f;
+    const auto start = SDL_GetPerformanceCounter();
+
+    for (uint32_t frame = 0; frame < opts.frames && app.running; frame++) {
+        push_script_events(next_event, script.value(), frame);
+
+        game::process_events(app, frame_time);
+
+        accumulator += frame_time;
+        while (accumulator >= game::timestep) {
+            accumulator -= game::timestep;
+            game::update(app, game::timestep);
+            ticks++;
+
+            // Everything up to this tick first, then its sounds, so they start on its first sample
+            const auto target = static_cast<size_t>(std::llround(static_cast<double>(ticks) * game::timestep * frequency));
+            audio::render(atx, target - rendered);
+            session.insert(session.end(), atx.output.begin(), atx.output.end());
+            rendered = target;
+
+            audio::flush_sounds(app, atx);
+        }
+
+        audio::update(atx);
+    }
+
+    // Last tick's sounds only went out after its mix, so a tail carries on until every sound started has played out
+    audio::flush_sounds(app, atx);
+
+    const auto now = static_cast<double>(app.sound_events.tick) * game::timestep;
+    const auto tail = static_cast<size_t>(std::ceil(std::max(audio::get_sounds_end(app.sound_events) - now, 0.0) * frequency));
+    const auto tick_frames = static_cast<size_t>(std::llround(game::timestep * frequency));
+
+    // A tick at a time, so music is still waited for
+    for (size_t done = 0; done < tail; done += tick_frames) {
+        audio::render(atx, std::min(tick_frames, tail - done));
+        session.insert(session.end(), atx.output.begin(), atx.output.end());
+    }
+
+    rendered += tail;
+
+    const auto elapsed = static_cast<double>(SDL_GetPerformanceCounter() - start) / static_cast<double>(SDL_GetPerformanceFrequency());
+    const auto seconds = static_cast<double>(rendered) / frequency;
+
+    journal::info("Rendered %1 s of audio over %2 ticks in %3 s, %4x realtime", seconds, ticks, elapsed, elapsed > 0.0 ? seconds / elapsed : 0.0);
+    journal::info("Audio checksum %1", hash_fnv1a(session.data(), session.size() * sizeof(int16_t)));
+
+    if (!headless::save_wave(opts.audio_path, session, atx.format.frequency, audio::MIXER_CHANNELS))
+        return false;
+
+    journal::info("Audio saved to '%1'", opts.audio_path);
+
+    return true;
+}
+#endif // SOFTWARE_MIXER_BACKEND
+
+static auto run_session(game::context_t &app, audio::context_t &atx, video::context_t &gtx, const headless::options_t &opts) -> bool {
+    if (opts.audio_path.empty())
+        return run_headless(app, atx, gtx, opts);
+
+#ifdef SOFTWARE_MIXER_BACKEND
+    return render_audio(app, atx, opts);
+#else
+    journal::critical("%1", "Rendering audio needs the software mixer backend");
+    return false;
+#endif // SOFTWARE_MIXER_BACKEND
+}
+#endif // HEADLESS_MODE
 
 extern auto main(int argc, char *argv[]) -> int {
-    (void)argc, (void)argv;
+    const auto opts = parse_options(argc, argv);
+    if (!opts)
+        return EXIT_FAILURE;
+
+    // Startup is traced until the first frame, the flag wins over the environment
+    const auto trace_env = getenv("ARKANOID_TRACE");
+    const auto trace_path = !opts.value().trace_path.empty() ? opts.value().trace_path : std::string{trace_env ? trace_env : ""};
+    if (!trace_path.empty()) {
+        trace::start(trace_path);
+        trace::name_thread("main");
+    }
 
-    if (auto app = game::init(GAME_CONF_PATH, true); app) {
-        auto audio_engine = audio::init(app.value());
+    if (auto app = game::init(GAME_CONF_PATH, true, opts.value().enabled); app) {
+        auto audio_engine = [&app] {
+            const trace::scope_t scope{"audio"};
+            return audio::init(app.value());
+        }();
         if (!audio_engine) {
             journal::critical("%1", "Couldn't init audio");
             return EXIT_FAILURE;
@@ -19,13 +283,38 @@ extern auto main(int argc, char *argv[]) -> int {
         if (!game::start(app.value()))
             return EXIT_FAILURE;
 
-        auto render = video::init(app.value());
+#ifdef HOT_RELOAD
+        // Closes the packed archive, so it goes before the music stream, which reads its track for as long as it plays
+        auto watcher = !opts.value().enabled ? hot_reload::init(app.value(), GAME_ASSETS_PATH, GAME_LEVELS_PATH, GAME_ASSETS_DIR) : std::optional<hot_reload::context_t>{};
+#endif // HOT_RELOAD
+
+        if (!app.value().music_track.empty())
+            audio::play_music(audio_engine.value(), resources::open_music(app.value(), app.value().music_track));
+
+        auto render = [&app] {
+            const trace::scope_t scope{"video"};
+            return video::init(app.value());
+        }();
 
         if (!render) {
             journal::critical("%1", "Couldn't init video");
             return EXIT_FAILURE;
         }
 
+        trace::finish();
+
+#ifdef HEADLESS_MODE
+        if (opts.value().enabled) {
+            const auto done = run_session(app.value(), audio_engine.value(), render.value(), opts.value());
+
+            audio::cleanup(audio_engine.value());
+            video::cleanup(render.value());
+            game::cleanup(app.value());
+
+            return done ? EXIT_SUCCESS : EXIT_FAILURE;
+        }
+#endif // HEADLESS_MODE
+
         auto current = 0ull;
         auto last = 0ull;
         auto timesteps = 0ull;
@@ -45,11 +334,22 @@ extern auto main(int argc, char *argv[]) -> int {
             while (accumulator >= game::timestep) {
                 accumulator -= game::timestep;
 
-                game::update(app.value(), audio_engine.value(), game::timestep);
+                game::update(app.value(), game::timestep);
 
                 timesteps++;
             }
 
+            // Sounds requested by every tick of this frame go out together
+            audio::flush_sounds(app.value(), audio_engine.value());
+            audio::update(audio_engine.value());
+
+#ifdef HOT_RELOAD
+            if (watcher)
+                hot_reload::update(app.value(), render.value(), watcher.value());
+#endif // HOT_RELOAD
+
+            resources::process_uploads(app.value(), TEXTURE_UPLOAD_BUDGET);
+
             game::draw(app.value(), render.value());
 
             auto projection = glm::ortho(0.0f, static_cast<float>(app.value().width), static_cast<float>(app.value().height), 0.0f, -1.0f, 1.0f);
@@ -63,6 +363,11 @@ extern auto main(int argc, char *argv[]) -> int {
             SDL_GL_SwapWindow(app.value().window);
         }
 
+#ifdef HOT_RELOAD
+        if (watcher)
+            hot_reload::cleanup(watcher.value());
+#endif // HOT_RELOAD
+
         audio::cleanup(audio_engine.value());
         video::cleanup(render.value());
         game::cleanup(app.value());
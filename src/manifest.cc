@@ -0,0 +1,239 @@
+#include <algorithm>
+
+#include "journal.hh"
+#include "json_reader.hh"
+#include "manifest.hh"
+
+namespace manifest {
+
+    static auto report(const json_reader_t &r, const std::string_view source) -> bool {
+        const auto [line, column] = json_get_location(r);
+        journal::error("%1:%2:%3: %4", source, line, column, r.error);
+
+        return false;
+    }
+
+    // Strings in a list, only the first one is kept
+    static auto read_first_string(json_reader_t &r, std::string &value) -> bool {
+        value.clear();
+
+        auto first = true;
+        return json_read_array(r, [&] {
+            if (!first)
+                return json_skip_value(r);
+
+            first = false;
+            return json_read_string(r, value);
+        });
+    }
+
+    auto read_game_conf(const std::string_view text, const std::string_view source, game_conf_t &conf) -> bool {
+        json_reader_t r{text};
+
+        const auto ok = json_read_object(r, [&] (const std::string_view key) {
+            if (key == "audio") {
+                return json_read_object(r, [&] (const std::string_view field) {
+                    if (field == "music")
+                        return json_read_string(r, conf.music);
+                    if (field == "frequency")
+                        return json_read_int(r, conf.audio_frequency);
+                    if (field == "buffer")
+                        return json_read_int(r, conf.audio_buffer);
+
+                    return json_skip_value(r);
+                });
+            }
+
+            if (key != "video")
+                return json_skip_value(r);
+
+            conf.has_video = true;
+
+            return json_read_object(r, [&] (const std::string_view field) {
+                if (field == "width")
+                    return json_read_int(r, conf.width);
+                if (field == "height")
+                    return json_read_int(r, conf.height);
+                if (field == "texture_memory")
+                    return json_read_int(r, conf.texture_memory);
+
+                return json_skip_value(r);
+            });
+        });
+
+        return ok ? true : report(r, source);
+    }
+
+    static auto read_tiles(json_reader_t &r, level_t &level) -> bool {
+        level.width = 0;
+        level.height = 0;
+        level.tiles.clear();
+
+        return json_read_array(r, [&] {
+            const auto row_start = level.tiles.size();
+            auto x = size_t{0};
+
+            const auto ok = json_read_array(r, [&] {
+                uint8_t tile = 0;
+                if (!json_read_int(r, tile))
+                    return false;
+
+                // Entries past the first row's width are ignored, like the DOM loader did
+                if (level.height == 0 || x < level.width)
+                    level.tiles.push_back(tile);
+
+                x++;
+                return true;
+            });
+
+            if (!ok)
+                return false;
+
+            if (level.height == 0)
+                level.width = x;
+            else
+                level.tiles.resize(row_start + level.width, 0);
+
+            level.height++;
+            return true;
+        });
+    }
+
+    auto read_levels(const std::string_view text, const std::string_view source, const std::function<void(const level_t&)> &fn) -> bool {
+        json_reader_t r{text};
+        level_t level;
+
+        const auto ok = json_read_object(r, [&] (const std::string_view key) {
+            if (key != "levels")
+                return json_skip_value(r);
+
+            return json_read_array(r, [&] {
+                level.name.clear();
+                level.enable = false;
+                level.has_data = false;
+                level.width = 0;
+                level.height = 0;
+                level.tiles.clear();
+
+                const auto read = json_read_object(r, [&] (const std::string_view field) {
+                    if (field == "name")
+                        return json_read_string(r, level.name);
+                    if (field == "enable")
+                        return json_read_bool(r, level.enable);
+                    if (field == "data") {
+                        level.has_data = true;
+                        return read_tiles(r, level);
+                    }
+
+                    return json_skip_value(r);
+                });
+
+                if (read)
+                    fn(level);
+
+                return read;
+            });
+        });
+
+        return ok ? true : report(r, source);
+    }
+
+    auto read_assets(const std::string_view text, const std::string_view source, assets_t &assets) -> bool {
+        json_reader_t r{text};
+
+        // Every section is a list of flat objects, fields are picked per section
+        const auto read_list = [&r] (auto &list, auto &&read_field) {
+            return json_read_array(r, [&] {
+                auto &item = list.emplace_back();
+                return json_read_object(r, [&] (const std::string_view key) {
+                    return read_field(item, key);
+                });
+            });
+        };
+
+        const auto ok = json_read_object(r, [&] (const std::string_view key) {
+            if (key == "shaders") {
+                return read_list(assets.shaders, [&r] (shader_t &sh, const std::string_view field) {
+                    if (field == "name")
+                        return json_read_string(r, sh.name);
+                    if (field == "source")
+                        return json_read_string(r, sh.source);
+
+                    return json_skip_value(r);
+                });
+            }
+
+            if (key == "programs") {
+                return read_list(assets.programs, [&r] (program_t &p, const std::string_view field) {
+                    if (field == "name")
+                        return json_read_string(r, p.name);
+                    if (field == "vertex")
+                        return json_read_string(r, p.vertex);
+                    if (field == "fragment")
+                        return json_read_string(r, p.fragment);
+
+                    return json_skip_value(r);
+                });
+            }
+
+            if (key == "postprocess") {
+                return read_list(assets.postprocess, [&r] (postprocess_t &pp, const std::string_view field) {
+                    if (field == "name")
+                        return json_read_string(r, pp.name);
+                    if (field == "program")
+                        return json_read_string(r, pp.program);
+                    if (field == "option")
+                        return json_read_string(r, pp.option);
+
+                    return json_skip_value(r);
+                });
+            }
+
+            if (key == "textures") {
+                return read_list(assets.textures, [&r] (texture_t &t, const std::string_view field) {
+                    if (field == "name")
+                        return json_read_string(r, t.name);
+                    if (field == "levels")
+                        return read_first_string(r, t.source);
+                    if (field == "stream")
+                        return json_read_bool(r, t.stream);
+                    if (field == "preload")
+                        return json_read_bool(r, t.preload);
+
+                    return json_skip_value(r);
+                });
+            }
+
+            if (key == "sounds") {
+                return read_list(assets.sounds, [&r] (sound_t &s, const std::string_view field) {
+                    if (field == "name")
+                        return json_read_string(r, s.name);
+                    if (field == "source")
+                        return json_read_string(r, s.source);
+                    if (field == "priority")
+                        return json_read_int(r, s.priority);
+                    if (field == "instances")
+                        return json_read_int(r, s.instances);
+
+                    return json_skip_value(r);
+                });
+            }
+
+            if (key == "music") {
+                return read_list(assets.music, [&r] (music_t &m, const std::string_view field) {
+                    if (field == "name")
+                        return json_read_string(r, m.name);
+                    if (field == "source")
+                        return json_read_string(r, m.source);
+
+                    return json_skip_value(r);
+                });
+            }
+
+            return json_skip_value(r);
+        });
+
+        return ok ? true : report(r, source);
+    }
+
+} // namespace manifest
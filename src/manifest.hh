@@ -0,0 +1,106 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <functional>
+
+// Typed views of game.conf, levels.json and assets.json, read in one streaming pass without a DOM
+
+namespace manifest {
+
+    typedef struct game_conf_type {
+        game_conf_type() = default;
+
+        bool has_video = false;
+        int width = 1024;
+        int height = 768;
+        size_t texture_memory = 0; // MiB, 0 keeps the default budget
+        std::string music; // track played from the start, none when empty
+        int audio_frequency = 0; // 0 keeps the backend default
+        int audio_buffer = 0; // frames per callback, 0 keeps the backend default
+    } game_conf_t;
+
+    typedef struct level_type {
+        level_type() = default;
+
+        std::string name;
+        bool enable = false;
+        bool has_data = false;
+
+        // Row-major, first row sets the width, short rows are padded with empty tiles
+        size_t width = 0;
+        size_t height = 0;
+        std::vector<uint8_t> tiles;
+    } level_t;
+
+    typedef struct shader_type {
+        shader_type() = default;
+
+        std::string name;
+        std::string source;
+    } shader_t;
+
+    typedef struct program_type {
+        program_type() = default;
+
+        std::string name;
+        std::string vertex;
+        std::string fragment;
+    } program_t;
+
+    typedef struct postprocess_type {
+        postprocess_type() = default;
+
+        std::string name;
+        std::string program;
+        std::string option;
+    } postprocess_t;
+
+    typedef struct texture_type {
+        texture_type() = default;
+
+        std::string name;
+        std::string source;
+        bool stream = false;
+        bool preload = false;
+    } texture_t;
+
+    typedef struct sound_type {
+        sound_type() = default;
+
+        std::string name;
+        std::string source;
+        int32_t priority = 0;
+        uint32_t instances = 0; // 0 keeps the default limit
+    } sound_t;
+
+    // Not loaded up front, streamed from the source when played
+    typedef struct music_type {
+        music_type() = default;
+
+        std::string name;
+        std::string source;
+    } music_t;
+
+    typedef struct assets_type {
+        assets_type() = default;
+
+        std::vector<shader_t> shaders;
+        std::vector<program_t> programs;
+        std::vector<postprocess_t> postprocess;
+        std::vector<texture_t> textures;
+        std::vector<sound_t> sounds;
+        std::vector<music_t> music;
+    } assets_t;
+
+    // Errors are logged with line and column of the source, false means nothing usable was read
+    auto read_game_conf(const std::string_view text, const std::string_view source, game_conf_t &conf) -> bool;
+    auto read_assets(const std::string_view text, const std::string_view source, assets_t &assets) -> bool;
+
+    // Each level is handed over as soon as it is read, its tile buffer is reused for the next one
+    auto read_levels(const std::string_view text, const std::string_view source, const std::function<void(const level_t&)> &fn) -> bool;
+
+} // namespace manifest
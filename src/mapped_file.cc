@@ -0,0 +1,79 @@
+#include <cstdlib>
+
+#ifdef __unix__
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+#include <SDL2/SDL.h>
+
+#include "mapped_file.hh"
+
+namespace resources {
+
+    auto map_file(const std::string_view path) -> std::optional<mapped_file_t> {
+#ifdef __unix__
+        const auto fd = open(path.data(), O_RDONLY);
+        if (fd < 0)
+            return {};
+
+        struct stat st;
+        if (fstat(fd, &st) != 0 || st.st_size <= 0) {
+            close(fd);
+            return {};
+        }
+
+        auto data = mmap(nullptr, static_cast<size_t>(st.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+        close(fd);
+
+        if (data == MAP_FAILED)
+            return {};
+
+        mapped_file_t file;
+        file.data = static_cast<const uint8_t*>(data);
+        file.size = static_cast<size_t>(st.st_size);
+        file.mapped = true;
+
+        return file;
+#else
+        // No mmap here, a single bulk read is the next best thing
+        auto rw = SDL_RWFromFile(path.data(), "rb");
+        if (!rw)
+            return {};
+
+        const auto size = SDL_RWsize(rw);
+        auto data = size > 0 ? static_cast<uint8_t*>(malloc(static_cast<size_t>(size))) : nullptr;
+        if (!data || SDL_RWread(rw, data, static_cast<size_t>(size), 1) != 1) {
+            free(data);
+            SDL_RWclose(rw);
+            return {};
+        }
+
+        SDL_RWclose(rw);
+
+        mapped_file_t file;
+        file.data = data;
+        file.size = static_cast<size_t>(size);
+        file.mapped = false;
+
+        return file;
+#endif
+    }
+
+    auto unmap_file(mapped_file_t &file) -> void {
+        if (!file.data)
+            return;
+
+#ifdef __unix__
+        if (file.mapped)
+            munmap(const_cast<uint8_t*>(file.data), file.size);
+#endif
+        if (!file.mapped)
+            free(const_cast<uint8_t*>(file.data));
+
+        file = mapped_file_t{};
+    }
+
+} // namespace resources
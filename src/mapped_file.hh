@@ -0,0 +1,22 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <optional>
+#include <string_view>
+
+namespace resources {
+
+    typedef struct mapped_file_type {
+        mapped_file_type() = default;
+
+        const uint8_t *data = nullptr;
+        size_t size = 0;
+        bool mapped = false;
+    } mapped_file_t;
+
+    // Read-only mmap where available, a single bulk read elsewhere
+    auto map_file(const std::string_view path) -> std::optional<mapped_file_t>;
+    auto unmap_file(mapped_file_t &file) -> void;
+
+} // namespace resources
@@ -0,0 +1,84 @@
+#include <algorithm>
+#include <cmath>
+
+#include <SDL2/SDL_cpuinfo.h>
+
+#include "mix_kernels.hh"
+
+namespace audio {
+
+    static auto accumulate_s16_mono(float *bus, const int16_t *src, size_t frames, float left, float right) -> void {
+        for (size_t i = 0; i < frames; i++) {
+            const auto v = static_cast<float>(src[i]);
+            bus[i * 2] += v * left;
+            bus[i * 2 + 1] += v * right;
+        }
+    }
+
+    static auto accumulate_s16_stereo(float *bus, const int16_t *src, size_t frames, float left, float right) -> void {
+        for (size_t i = 0; i < frames; i++) {
+            bus[i * 2] += static_cast<float>(src[i * 2]) * left;
+            bus[i * 2 + 1] += static_cast<float>(src[i * 2 + 1]) * right;
+        }
+    }
+
+    static auto accumulate_f32_mono(float *bus, const float *src, size_t frames, float left, float right) -> void {
+        for (size_t i = 0; i < frames; i++) {
+            bus[i * 2] += src[i] * left;
+            bus[i * 2 + 1] += src[i] * right;
+        }
+    }
+
+    static auto accumulate_f32_stereo(float *bus, const float *src, size_t frames, float left, float right) -> void {
+        for (size_t i = 0; i < frames; i++) {
+            bus[i * 2] += src[i * 2] * left;
+            bus[i * 2 + 1] += src[i * 2 + 1] * right;
+        }
+    }
+
+    static auto pan(float *bus, size_t frames, float left, float right) -> void {
+        for (size_t i = 0; i < frames; i++) {
+            bus[i * 2] *= left;
+            bus[i * 2 + 1] *= right;
+        }
+    }
+
+    static auto saturate_s16(int16_t *output, const float *bus, size_t count, float scale) -> void {
+        for (size_t i = 0; i < count; i++) {
+            const auto v = std::min(std::max(bus[i] * scale, -32768.0f), 32767.0f);
+            output[i] = static_cast<int16_t>(std::lrint(v));
+        }
+    }
+
+    auto scalar_mix_kernels() -> const mix_kernels_t* {
+        static const auto kernels = [] {
+            mix_kernels_t k;
+            k.name = "scalar";
+            k.accumulate_s16_mono = accumulate_s16_mono;
+            k.accumulate_s16_stereo = accumulate_s16_stereo;
+            k.accumulate_f32_mono = accumulate_f32_mono;
+            k.accumulate_f32_stereo = accumulate_f32_stereo;
+            k.pan = pan;
+            k.saturate_s16 = saturate_s16;
+            return k;
+        }();
+
+        return &kernels;
+    }
+
+    auto select_mix_kernels() -> const mix_kernels_t* {
+        static const auto selected = [] {
+            // CPU first, the tables themselves are built with code it may not run
+            if (SDL_HasAVX2() && avx2_mix_kernels())
+                return avx2_mix_kernels();
+
+            if (SDL_HasSSE2() && sse2_mix_kernels())
+                return sse2_mix_kernels();
+
+            return scalar_mix_kernels();
+        }();
+
+        return selected;
+    }
+
+} // namespace audio
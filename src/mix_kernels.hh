@@ -0,0 +1,43 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+
+// Inner loops of the software mixer, one table per instruction set picked once at startup.
+// Every version does the same multiplies and adds in the same order, so they all give the same bits.
+
+namespace audio {
+
+    // Bus is interleaved stereo float, mono sources are spread over it with a gain per side
+    typedef void (*accumulate_s16_t)(float *bus, const int16_t *src, size_t frames, float left, float right);
+    typedef void (*accumulate_f32_t)(float *bus, const float *src, size_t frames, float left, float right);
+
+    // Scales the two sides of the bus in place
+    typedef void (*pan_t)(float *bus, size_t frames, float left, float right);
+
+    // Count is in samples, values are scaled then clamped to int16 and rounded to nearest
+    typedef void (*saturate_s16_t)(int16_t *output, const float *bus, size_t count, float scale);
+
+    typedef struct mix_kernels_type {
+        mix_kernels_type() = default;
+
+        const char *name = nullptr;
+        accumulate_s16_t accumulate_s16_mono = nullptr;
+        accumulate_s16_t accumulate_s16_stereo = nullptr;
+        accumulate_f32_t accumulate_f32_mono = nullptr;
+        accumulate_f32_t accumulate_f32_stereo = nullptr;
+        pan_t pan = nullptr;
+        saturate_s16_t saturate_s16 = nullptr;
+    } mix_kernels_t;
+
+    // Reference versions, always there
+    auto scalar_mix_kernels() -> const mix_kernels_t*;
+
+    // Null unless built for x86, only to be called once the CPU is known to have the instructions
+    auto sse2_mix_kernels() -> const mix_kernels_t*;
+    auto avx2_mix_kernels() -> const mix_kernels_t*;
+
+    // Fastest table the CPU runs, worked out on the first call
+    auto select_mix_kernels() -> const mix_kernels_t*;
+
+} // namespace audio
@@ -0,0 +1,129 @@
+#include "mix_kernels.hh"
+
+// Built with AVX2 enabled, only ever called once the CPU said it has it. No FMA, that would round differently.
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+
+#include <immintrin.h>
+
+namespace audio {
+
+    namespace {
+
+        inline auto widen(const __m128i v) -> __m256 {
+            return _mm256_cvtepi32_ps(_mm256_cvtepi16_epi32(v));
+        }
+
+        inline auto accumulate(float *bus, const __m256 v, const __m256 gain) -> void {
+            _mm256_storeu_ps(bus, _mm256_add_ps(_mm256_loadu_ps(bus), _mm256_mul_ps(v, gain)));
+        }
+
+        // Unpacks stay inside each 128 bit lane, the permutes put the four frames of each half back in order
+        inline auto accumulate_mono(float *bus, const __m256 v, const __m256 gain) -> void {
+            const auto lo = _mm256_unpacklo_ps(v, v);
+            const auto hi = _mm256_unpackhi_ps(v, v);
+            accumulate(bus, _mm256_permute2f128_ps(lo, hi, 0x20), gain);
+            accumulate(bus + 8, _mm256_permute2f128_ps(lo, hi, 0x31), gain);
+        }
+
+        auto accumulate_s16_mono(float *bus, const int16_t *src, size_t frames, float left, float right) -> void {
+            const auto gain = _mm256_setr_ps(left, right, left, right, left, right, left, right);
+
+            size_t i = 0;
+            for (; i + 8 <= frames; i += 8)
+                accumulate_mono(bus + i * 2, widen(_mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i))), gain);
+
+            scalar_mix_kernels()->accumulate_s16_mono(bus + i * 2, src + i, frames - i, left, right);
+        }
+
+        auto accumulate_s16_stereo(float *bus, const int16_t *src, size_t frames, float left, float right) -> void {
+            const auto gain = _mm256_setr_ps(left, right, left, right, left, right, left, right);
+
+            size_t i = 0;
+            for (; i + 8 <= frames; i += 8) {
+                const auto v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + i * 2));
+                accumulate(bus + i * 2, widen(_mm256_castsi256_si128(v)), gain);
+                accumulate(bus + i * 2 + 8, widen(_mm256_extracti128_si256(v, 1)), gain);
+            }
+
+            scalar_mix_kernels()->accumulate_s16_stereo(bus + i * 2, src + i * 2, frames - i, left, right);
+        }
+
+        auto accumulate_f32_mono(float *bus, const float *src, size_t frames, float left, float right) -> void {
+            const auto gain = _mm256_setr_ps(left, right, left, right, left, right, left, right);
+
+            size_t i = 0;
+            for (; i + 8 <= frames; i += 8)
+                accumulate_mono(bus + i * 2, _mm256_loadu_ps(src + i), gain);
+
+            scalar_mix_kernels()->accumulate_f32_mono(bus + i * 2, src + i, frames - i, left, right);
+        }
+
+        auto accumulate_f32_stereo(float *bus, const float *src, size_t frames, float left, float right) -> void {
+            const auto gain = _mm256_setr_ps(left, right, left, right, left, right, left, right);
+
+            size_t i = 0;
+            for (; i + 4 <= frames; i += 4)
+                accumulate(bus + i * 2, _mm256_loadu_ps(src + i * 2), gain);
+
+            scalar_mix_kernels()->accumulate_f32_stereo(bus + i * 2, src + i * 2, frames - i, left, right);
+        }
+
+        auto pan(float *bus, size_t frames, float left, float right) -> void {
+            const auto gain = _mm256_setr_ps(left, right, left, right, left, right, left, right);
+
+            size_t i = 0;
+            for (; i + 4 <= frames; i += 4)
+                _mm256_storeu_ps(bus + i * 2, _mm256_mul_ps(_mm256_loadu_ps(bus + i * 2), gain));
+
+            scalar_mix_kernels()->pan(bus + i * 2, frames - i, left, right);
+        }
+
+        // Pack works per lane, the 64 bit permute restores sample order
+        auto saturate_s16(int16_t *output, const float *bus, size_t count, float scale) -> void {
+            const auto s = _mm256_set1_ps(scale);
+            const auto lo = _mm256_set1_ps(-32768.0f);
+            const auto hi = _mm256_set1_ps(32767.0f);
+
+            size_t i = 0;
+            for (; i + 16 <= count; i += 16) {
+                const auto a = _mm256_min_ps(_mm256_max_ps(_mm256_mul_ps(_mm256_loadu_ps(bus + i), s), lo), hi);
+                const auto b = _mm256_min_ps(_mm256_max_ps(_mm256_mul_ps(_mm256_loadu_ps(bus + i + 8), s), lo), hi);
+                const auto packed = _mm256_packs_epi32(_mm256_cvtps_epi32(a), _mm256_cvtps_epi32(b));
+                _mm256_storeu_si256(reinterpret_cast<__m256i*>(output + i), _mm256_permute4x64_epi64(packed, 0xd8));
+            }
+
+            scalar_mix_kernels()->saturate_s16(output + i, bus + i, count - i, scale);
+        }
+
+    } // namespace
+
+    auto avx2_mix_kernels() -> const mix_kernels_t* {
+        static const auto kernels = [] {
+            mix_kernels_t k;
+            k.name = "avx2";
+            k.accumulate_s16_mono = accumulate_s16_mono;
+            k.accumulate_s16_stereo = accumulate_s16_stereo;
+            k.accumulate_f32_mono = accumulate_f32_mono;
+            k.accumulate_f32_stereo = accumulate_f32_stereo;
+            k.pan = pan;
+            k.saturate_s16 = saturate_s16;
+            return k;
+        }();
+
+        return &kernels;
+    }
+
+} // namespace audio
+
+#else
+
+namespace audio {
+
+    auto avx2_mix_kernels() -> const mix_kernels_t* {
+        return nullptr;
+    }
+
+} // namespace audio
+
+#endif
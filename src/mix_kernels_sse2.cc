@@ -0,0 +1,134 @@
+#include "mix_kernels.hh"
+
+// Built with SSE2 enabled, only ever called once the CPU said it has it
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+
+#include <emmintrin.h>
+
+namespace audio {
+
+    namespace {
+
+        // Four int16 to float, sign extended by unpacking into the high half and shifting back
+        inline auto widen_lo(const __m128i v) -> __m128 {
+            return _mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpacklo_epi16(v, v), 16));
+        }
+
+        inline auto widen_hi(const __m128i v) -> __m128 {
+            return _mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpackhi_epi16(v, v), 16));
+        }
+
+        inline auto accumulate(float *bus, const __m128 v, const __m128 gain) -> void {
+            _mm_storeu_ps(bus, _mm_add_ps(_mm_loadu_ps(bus), _mm_mul_ps(v, gain)));
+        }
+
+        // Two mono frames per stereo vector
+        inline auto accumulate_mono(float *bus, const __m128 v, const __m128 gain) -> void {
+            accumulate(bus, _mm_unpacklo_ps(v, v), gain);
+            accumulate(bus + 4, _mm_unpackhi_ps(v, v), gain);
+        }
+
+        auto accumulate_s16_mono(float *bus, const int16_t *src, size_t frames, float left, float right) -> void {
+            const auto gain = _mm_setr_ps(left, right, left, right);
+
+            size_t i = 0;
+            for (; i + 8 <= frames; i += 8) {
+                const auto v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+                accumulate_mono(bus + i * 2, widen_lo(v), gain);
+                accumulate_mono(bus + i * 2 + 8, widen_hi(v), gain);
+            }
+
+            scalar_mix_kernels()->accumulate_s16_mono(bus + i * 2, src + i, frames - i, left, right);
+        }
+
+        auto accumulate_s16_stereo(float *bus, const int16_t *src, size_t frames, float left, float right) -> void {
+            const auto gain = _mm_setr_ps(left, right, left, right);
+
+            size_t i = 0;
+            for (; i + 4 <= frames; i += 4) {
+                const auto v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i * 2));
+                accumulate(bus + i * 2, widen_lo(v), gain);
+                accumulate(bus + i * 2 + 4, widen_hi(v), gain);
+            }
+
+            scalar_mix_kernels()->accumulate_s16_stereo(bus + i * 2, src + i * 2, frames - i, left, right);
+        }
+
+        auto accumulate_f32_mono(float *bus, const float *src, size_t frames, float left, float right) -> void {
+            const auto gain = _mm_setr_ps(left, right, left, right);
+
+            size_t i = 0;
+            for (; i + 4 <= frames; i += 4)
+                accumulate_mono(bus + i * 2, _mm_loadu_ps(src + i), gain);
+
+            scalar_mix_kernels()->accumulate_f32_mono(bus + i * 2, src + i, frames - i, left, right);
+        }
+
+        auto accumulate_f32_stereo(float *bus, const float *src, size_t frames, float left, float right) -> void {
+            const auto gain = _mm_setr_ps(left, right, left, right);
+
+            size_t i = 0;
+            for (; i + 2 <= frames; i += 2)
+                accumulate(bus + i * 2, _mm_loadu_ps(src + i * 2), gain);
+
+            scalar_mix_kernels()->accumulate_f32_stereo(bus + i * 2, src + i * 2, frames - i, left, right);
+        }
+
+        auto pan(float *bus, size_t frames, float left, float right) -> void {
+            const auto gain = _mm_setr_ps(left, right, left, right);
+
+            size_t i = 0;
+            for (; i + 2 <= frames; i += 2)
+                _mm_storeu_ps(bus + i * 2, _mm_mul_ps(_mm_loadu_ps(bus + i * 2), gain));
+
+            scalar_mix_kernels()->pan(bus + i * 2, frames - i, left, right);
+        }
+
+        // Clamped while still float, cvtps2dq turns anything out of int32 range into INT32_MIN
+        auto saturate_s16(int16_t *output, const float *bus, size_t count, float scale) -> void {
+            const auto s = _mm_set1_ps(scale);
+            const auto lo = _mm_set1_ps(-32768.0f);
+            const auto hi = _mm_set1_ps(32767.0f);
+
+            size_t i = 0;
+            for (; i + 8 <= count; i += 8) {
+                const auto a = _mm_min_ps(_mm_max_ps(_mm_mul_ps(_mm_loadu_ps(bus + i), s), lo), hi);
+                const auto b = _mm_min_ps(_mm_max_ps(_mm_mul_ps(_mm_loadu_ps(bus + i + 4), s), lo), hi);
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(output + i), _mm_packs_epi32(_mm_cvtps_epi32(a), _mm_cvtps_epi32(b)));
+            }
+
+            scalar_mix_kernels()->saturate_s16(output + i, bus + i, count - i, scale);
+        }
+
+    } // namespace
+
+    auto sse2_mix_kernels() -> const mix_kernels_t* {
+        static const auto kernels = [] {
+            mix_kernels_t k;
+            k.name = "sse2";
+            k.accumulate_s16_mono = accumulate_s16_mono;
+            k.accumulate_s16_stereo = accumulate_s16_stereo;
+            k.accumulate_f32_mono = accumulate_f32_mono;
+            k.accumulate_f32_stereo = accumulate_f32_stereo;
+            k.pan = pan;
+            k.saturate_s16 = saturate_s16;
+            return k;
+        }();
+
+        return &kernels;
+    }
+
+} // namespace audio
+
+#else
+
+namespace audio {
+
+    auto sse2_mix_kernels() -> const mix_kernels_t* {
+        return nullptr;
+    }
+
+} // namespace audio
+
+#endif
@@ -0,0 +1,155 @@
+#include <algorithm>
+
+#include "music_stream.hh"
+#include "mixer.hh"
+
+namespace audio {
+
+    static_assert(MUSIC_CHANNELS == MIXER_CHANNELS, "music is mixed without conversion");
+
+    auto create_mixer() -> std::unique_ptr<mixer_t> {
+        auto mixer = std::make_unique<mixer_t>();
+        mixer->kernels = select_mix_kernels();
+
+        return mixer;
+    }
+
+    static auto submit(mixer_t &mixer, const mixer_command_t &cmd) -> bool {
+        if (push(mixer.commands, cmd))
+            return true;
+
+        mixer.dropped_commands++;
+        return false;
+    }
+
+    auto submit_play(mixer_t &mixer, const int16_t *samples, const uint32_t frames, const float gain, const bool looped) -> bool {
+        if (!samples || frames == 0)
+            return false;
+
+        mixer_command_t cmd;
+        cmd.type = mixer_command::play;
+        cmd.samples = samples;
+        cmd.frames = frames;
+        cmd.gain = gain;
+        cmd.looped = looped;
+        cmd.issued_ns = probe_now();
+
+        return submit(mixer, cmd);
+    }
+
+    auto submit_stop(mixer_t &mixer, const int16_t *samples) -> bool {
+        mixer_command_t cmd;
+        cmd.type = mixer_command::stop;
+        cmd.samples = samples;
+
+        return submit(mixer, cmd);
+    }
+
+    auto submit_volume(mixer_t &mixer, const float volume) -> bool {
+        mixer_command_t cmd;
+        cmd.type = mixer_command::volume;
+        cmd.gain = volume;
+
+        return submit(mixer, cmd);
+    }
+
+    static auto apply_commands(mixer_t &mixer) -> void {
+        const auto now = probe_now();
+
+        mixer_command_t cmd;
+        while (pop(mixer.commands, cmd)) {
+            switch (cmd.type) {
+            case mixer_command::play: {
+                const auto voice = std::find_if(mixer.voices.begin(), mixer.voices.end(), [] (const auto &v) {
+                    return v.samples == nullptr;
+                });
+
+                if (voice == mixer.voices.end()) {
+                    mixer.dropped_voices.fetch_add(1, std::memory_order_relaxed);
+                    break;
+                }
+
+                voice->samples = cmd.samples;
+                voice->frames = cmd.frames;
+                voice->position = 0;
+                voice->gain = cmd.gain;
+                voice->looped = cmd.looped;
+
+                mixer.started_voices.fetch_add(1, std::memory_order_relaxed);
+                record_latency(mixer.latency, cmd.issued_ns, now);
+                break;
+            }
+            case mixer_command::stop:
+                for (auto &v : mixer.voices)
+                    if (!cmd.samples || v.samples == cmd.samples)
+                        v.samples = nullptr;
+                break;
+            case mixer_command::volume:
+                mixer.volume = cmd.gain;
+                break;
+            }
+        }
+    }
+
+    // Accumulates into the bus and advances the voice, freeing it when a one-shot ends
+    static auto mix_voice(const mix_kernels_t &kernels, mixer_voice_t &voice, float *bus, const size_t frames) -> void {
+        constexpr auto scale = 1.0f / 32768.0f;
+        const auto gain = voice.gain * scale;
+
+        auto done = size_t{0};
+        while (done < frames && voice.samples) {
+            const auto count = std::min<size_t>(frames - done, voice.frames - voice.position);
+            const auto src = voice.samples + static_cast<size_t>(voice.position) * MIXER_CHANNELS;
+            auto dst = bus + done * MIXER_CHANNELS;
+
+            kernels.accumulate_s16_stereo(dst, src, count, gain, gain);
+
+            done += count;
+            voice.position += static_cast<uint32_t>(count);
+
+            if (voice.position == voice.frames) {
+                if (voice.looped)
+                    voice.position = 0;
+                else
+                    voice.samples = nullptr;
+            }
+        }
+    }
+
+    static auto mix_music(mixer_t &mixer, float *bus, const size_t frames) -> void {
+        constexpr auto scale = 1.0f / 32768.0f;
+
+        auto block = mixer.music_block.data();
+        read_music(*mixer.music, block, frames);
+
+        mixer.kernels->accumulate_s16_stereo(bus, block, frames, scale, scale);
+    }
+
+    auto mix(mixer_t &mixer, int16_t *output, const size_t frames) -> void {
+        apply_commands(mixer);
+
+        for (size_t offset = 0; offset < frames; offset += MIXER_BLOCK_FRAMES) {
+            const auto count = std::min(frames - offset, MIXER_BLOCK_FRAMES);
+            auto bus = mixer.bus.data();
+
+            std::fill_n(bus, count * MIXER_CHANNELS, 0.0f);
+
+            for (auto &voice : mixer.voices)
+                if (voice.samples)
+                    mix_voice(*mixer.kernels, voice, bus, count);
+
+            if (mixer.music)
+                mix_music(mixer, bus, count);
+
+            mixer.kernels->saturate_s16(output + offset * MIXER_CHANNELS, bus, count * MIXER_CHANNELS, mixer.volume * 32768.0f);
+        }
+
+        const auto active = std::count_if(mixer.voices.begin(), mixer.voices.end(), [] (const auto &v) {
+            return v.samples != nullptr;
+        });
+
+        mixer.active_voices.store(static_cast<uint32_t>(active), std::memory_order_relaxed);
+        mixer.mixed_frames.fetch_add(frames, std::memory_order_relaxed);
+    }
+
+} // namespace audio
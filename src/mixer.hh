@@ -0,0 +1,90 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <array>
+#include <atomic>
+#include <memory>
+
+#include "spsc_queue.hh"
+#include "callback_stats.hh"
+#include "mix_kernels.hh"
+
+// Software mixer, the game thread sends commands and the audio thread mixes without locks or allocation
+
+namespace audio {
+
+    struct music_stream_type;
+    typedef music_stream_type music_stream_t;
+
+    constexpr size_t MIXER_VOICES = 32;
+    constexpr size_t MIXER_COMMANDS = 256;
+    constexpr size_t MIXER_BLOCK_FRAMES = 512; // larger requests are mixed block by block
+    constexpr int MIXER_FREQUENCY = 44100; // null device, the real one opens at the game.conf rate
+    constexpr int MIXER_CHANNELS = 2;
+
+    enum class mixer_command : uint32_t {
+        play,
+        stop,
+        volume
+    };
+
+    typedef struct mixer_command_type {
+        mixer_command_type() = default;
+
+        mixer_command type = mixer_command::play;
+        const int16_t *samples = nullptr; // interleaved stereo, null stops every voice
+        uint32_t frames = 0;
+        float gain = 1.0f;
+        bool looped = false;
+        uint64_t issued_ns = 0; // for the latency probe
+    } mixer_command_t;
+
+    // Free while samples is null
+    typedef struct mixer_voice_type {
+        mixer_voice_type() = default;
+
+        const int16_t *samples = nullptr;
+        uint32_t frames = 0;
+        uint32_t position = 0;
+        float gain = 1.0f;
+        bool looped = false;
+    } mixer_voice_t;
+
+    typedef struct mixer_type {
+        mixer_type() = default;
+
+        spsc_queue_t<mixer_command_t, MIXER_COMMANDS> commands;
+        std::array<mixer_voice_t, MIXER_VOICES> voices = {};
+        std::array<float, MIXER_BLOCK_FRAMES * MIXER_CHANNELS> bus = {};
+        float volume = 1.0f;
+        const mix_kernels_t *kernels = nullptr; // picked for the CPU when created
+
+        // Streamed on top of the voices, only swapped while the audio thread is held off
+        music_stream_t *music = nullptr;
+        std::array<int16_t, MIXER_BLOCK_FRAMES * MIXER_CHANNELS> music_block = {};
+
+        // Written by the audio thread, safe to read from any other
+        std::atomic<uint32_t> active_voices{0};
+        std::atomic<uint64_t> started_voices{0};
+        std::atomic<uint64_t> dropped_voices{0};
+        std::atomic<uint64_t> mixed_frames{0};
+
+        latency_probe_t latency;
+        callback_stats_t stats; // filled by the device callback, not by render
+
+        // Written by the producer only
+        uint64_t dropped_commands = 0;
+    } mixer_t;
+
+    auto create_mixer() -> std::unique_ptr<mixer_t>;
+
+    // Producer side, false when the queue is full and the command was dropped
+    auto submit_play(mixer_t &mixer, const int16_t *samples, const uint32_t frames, const float gain, const bool looped) -> bool;
+    auto submit_stop(mixer_t &mixer, const int16_t *samples) -> bool;
+    auto submit_volume(mixer_t &mixer, const float volume) -> bool;
+
+    // Consumer side, fills frames of interleaved stereo int16
+    auto mix(mixer_t &mixer, int16_t *output, const size_t frames) -> void;
+
+} // namespace audio
@@ -0,0 +1,324 @@
+#include <cstring>
+#include <chrono>
+#include <algorithm>
+
+#include <SDL2/SDL_rwops.h>
+
+#include "journal.hh"
+#include "trace.hh"
+#include "pcm_convert.hh"
+#include "music_stream.hh"
+
+namespace audio {
+
+    static auto rewind_wave(music_source_t &src) -> bool {
+        src.data_left = src.data_size;
+        return SDL_RWseek(src.rw, src.data_offset, RW_SEEK_SET) == src.data_offset;
+    }
+
+    // Chunks are found wherever they sit, the decoder reads 8 and 16 bit PCM
+    static auto open_wave(music_source_t &src) -> bool {
+        const auto layout = parse_wave(src.rw);
+        if (!layout)
+            return false;
+
+        const auto &spec = layout.value().spec;
+        if (spec.format != sample_format::u8 && spec.format != sample_format::s16)
+            return false;
+
+        if (spec.channels != 1 && spec.channels != 2)
+            return false;
+
+        src.frequency = spec.frequency;
+        src.channels = spec.channels;
+        src.bits = spec.format == sample_format::u8 ? 8 : 16;
+        src.data_offset = static_cast<int64_t>(layout.value().data_offset);
+        src.data_size = layout.value().data_size;
+
+        return rewind_wave(src);
+    }
+
+    // Source frames converted to stereo int16, zero at the end of the track
+    static auto decode_wave(music_source_t &src) -> size_t {
+        const auto frame_size = static_cast<size_t>(src.channels * src.bits / 8);
+        const auto frames = std::min<uint64_t>(MUSIC_CHUNK_FRAMES, src.data_left / frame_size);
+        if (frames == 0)
+            return 0;
+
+        src.raw.resize(frames * frame_size);
+        if (SDL_RWread(src.rw, src.raw.data(), src.raw.size(), 1) != 1)
+            return 0;
+
+        src.data_left -= src.raw.size();
+        src.frames.resize(frames * MUSIC_CHANNELS);
+
+        const auto samples = frames * static_cast<size_t>(src.channels);
+        for (size_t i = 0; i < samples; i++) {
+            const auto value = src.bits == 8
+                    ? static_cast<int16_t>((src.raw[i] - 128) << 8)
+                    : static_cast<int16_t>(src.raw[i * 2] | (src.raw[i * 2 + 1] << 8));
+
+            // Mono is copied to both channels
+            if (src.channels == 1) {
+                src.frames[i * 2] = value;
+                src.frames[i * 2 + 1] = value;
+            } else {
+                src.frames[i] = value;
+            }
+        }
+
+        return frames;
+    }
+
+#ifdef OGG_MUSIC
+
+    static auto ogg_read(void *ptr, size_t size, size_t count, void *rw) -> size_t {
+        return SDL_RWread(static_cast<SDL_RWops*>(rw), ptr, size, count);
+    }
+
+    static auto ogg_seek(void *rw, ogg_int64_t offset, int whence) -> int {
+        return SDL_RWseek(static_cast<SDL_RWops*>(rw), offset, whence) < 0 ? -1 : 0;
+    }
+
+    static auto ogg_tell(void *rw) -> long {
+        return static_cast<long>(SDL_RWtell(static_cast<SDL_RWops*>(rw)));
+    }
+
+    static auto open_ogg(music_source_t &src) -> bool {
+        const ov_callbacks callbacks = {ogg_read, ogg_seek, nullptr, ogg_tell};
+        if (ov_open_callbacks(src.rw, &src.vorbis, nullptr, 0, callbacks) != 0)
+            return false;
+
+        const auto info = ov_info(&src.vorbis, -1);
+        src.channels = info->channels;
+        src.frequency = static_cast<int>(info->rate);
+        src.bits = 16;
+
+        if (src.channels == 1 || src.channels == 2)
+            return true;
+
+        ov_clear(&src.vorbis);
+        return false;
+    }
+
+    static auto decode_ogg(music_source_t &src) -> size_t {
+        const auto frame_size = static_cast<size_t>(src.channels) * sizeof(int16_t);
+        src.raw.resize(MUSIC_CHUNK_FRAMES * frame_size);
+
+        // Vorbis hands out at most one packet per call, so keep going until the chunk is full
+        auto filled = size_t{0};
+        while (filled < src.raw.size()) {
+            auto section = 0;
+            const auto read = ov_read(&src.vorbis, reinterpret_cast<char*>(src.raw.data() + filled), static_cast<int>(src.raw.size() - filled), 0, 2, 1, &section);
+            if (read <= 0)
+                break;
+
+            filled += static_cast<size_t>(read);
+        }
+
+        const auto frames = filled / frame_size;
+        src.frames.resize(frames * MUSIC_CHANNELS);
+
+        const auto pcm = reinterpret_cast<const int16_t*>(src.raw.data());
+        for (size_t i = 0; i < frames; i++) {
+            src.frames[i * 2] = pcm[i * static_cast<size_t>(src.channels)];
+            src.frames[i * 2 + 1] = pcm[i * static_cast<size_t>(src.channels) + static_cast<size_t>(src.channels) - 1];
+        }
+
+        return frames;
+    }
+
+#endif // OGG_MUSIC
+
+    static auto decode(music_source_t &src) -> size_t {
+#ifdef OGG_MUSIC
+        if (src.codec == music_codec::ogg)
+            return decode_ogg(src);
+#endif // OGG_MUSIC
+
+        return decode_wave(src);
+    }
+
+    static auto rewind(music_source_t &src) -> bool {
+#ifdef OGG_MUSIC
+        if (src.codec == music_codec::ogg)
+            return ov_raw_seek(&src.vorbis, 0) == 0;
+#endif // OGG_MUSIC
+
+        return rewind_wave(src);
+    }
+
+    // Linear interpolation between neighbour frames, the previous chunk's last frame leads the next one
+    static auto resample(music_source_t &src, const size_t frames) -> void {
+        src.pending.clear();
+        src.pending_offset = 0;
+
+        if (src.frequency == src.output_frequency) {
+            src.pending.assign(src.frames.begin(), src.frames.begin() + static_cast<std::ptrdiff_t>(frames * MUSIC_CHANNELS));
+            return;
+        }
+
+        const auto step = static_cast<double>(src.frequency) / src.output_frequency;
+        const auto at = [&] (const size_t frame, const size_t channel) {
+            return frame == 0 ? src.last[channel] : src.frames[(frame - 1) * MUSIC_CHANNELS + channel];
+        };
+
+        auto phase = src.phase;
+        while (phase < static_cast<double>(frames)) {
+            const auto index = static_cast<size_t>(phase);
+            const auto t = static_cast<float>(phase - static_cast<double>(index));
+
+            for (size_t c = 0; c < MUSIC_CHANNELS; c++) {
+                const auto a = static_cast<float>(at(index, c));
+                const auto b = static_cast<float>(at(index + 1, c));
+                src.pending.push_back(static_cast<int16_t>(a + (b - a) * t));
+            }
+
+            phase += step;
+        }
+
+        src.phase = phase - static_cast<double>(frames);
+        std::copy_n(&src.frames[(frames - 1) * MUSIC_CHANNELS], MUSIC_CHANNELS, src.last);
+    }
+
+    static auto close_source(music_source_t &src) -> void {
+#ifdef OGG_MUSIC
+        if (src.codec == music_codec::ogg)
+            ov_clear(&src.vorbis);
+#endif // OGG_MUSIC
+
+        if (src.rw)
+            SDL_RWclose(src.rw);
+
+        src.rw = nullptr;
+    }
+
+    // Decodes a chunk when the last one is all in the ring, false once the track is over
+    static auto decode_step(music_stream_t &stream) -> bool {
+        auto &src = stream.source;
+
+        if (src.pending_offset == src.pending.size()) {
+            auto frames = decode(src);
+            if (frames == 0 && stream.looped && rewind(src))
+                frames = decode(src);
+
+            if (frames == 0) {
+                stream.finished.store(true, std::memory_order_release);
+                return false;
+            }
+
+            resample(src, frames);
+        }
+
+        src.pending_offset += push_n(stream.ring, src.pending.data() + src.pending_offset, src.pending.size() - src.pending_offset);
+
+        return true;
+    }
+
+    static auto is_ring_full(const music_stream_t &stream) -> bool {
+        return stream.source.pending_offset < stream.source.pending.size();
+    }
+
+    // Keeps the ring topped up, sleeps while it is full, the consumer never waits on it
+    static auto decode_loop(music_stream_t &stream) -> void {
+        trace::name_thread("music");
+
+        while (!stream.stop.load(std::memory_order_relaxed) && decode_step(stream))
+            if (is_ring_full(stream))
+                std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    }
+
+    auto open_music(SDL_RWops *rw, const bool looped, const int frequency) -> std::unique_ptr<music_stream_t> {
+        if (!rw)
+            return nullptr;
+
+        auto stream = std::make_unique<music_stream_t>();
+        stream->looped = looped;
+
+        auto &src = stream->source;
+        src.rw = rw;
+        src.output_frequency = frequency;
+
+        char magic[4] = {};
+        SDL_RWread(rw, magic, sizeof magic, 1);
+        SDL_RWseek(rw, 0, RW_SEEK_SET);
+
+        auto ok = false;
+        if (memcmp(magic, "RIFF", sizeof magic) == 0) {
+            src.codec = music_codec::wav;
+            ok = open_wave(src);
+        } else if (memcmp(magic, "OggS", sizeof magic) == 0) {
+            src.codec = music_codec::ogg;
+#ifdef OGG_MUSIC
+            ok = open_ogg(src);
+#else
+            journal::warning("%1", "Built without OGG_MUSIC, ogg tracks can't be played");
+#endif // OGG_MUSIC
+        }
+
+        if (!ok) {
+            // A failed ov_open leaves nothing to clear
+            src.codec = music_codec::wav;
+            close_source(src);
+            return nullptr;
+        }
+
+        journal::debug("Music stream %1 Hz, %2 channels, %3 bits", src.frequency, src.channels, src.bits);
+
+        // Ring starts full, so the first callbacks don't race the decoder
+        while (decode_step(*stream) && !is_ring_full(*stream)) {
+        }
+
+        stream->decoder = std::thread{decode_loop, std::ref(*stream)};
+
+        return stream;
+    }
+
+    auto close_music(std::unique_ptr<music_stream_t> &stream) -> void {
+        if (!stream)
+            return;
+
+        stream->stop.store(true, std::memory_order_relaxed);
+        if (stream->decoder.joinable())
+            stream->decoder.join();
+
+        report_music_underruns(*stream);
+        close_source(stream->source);
+
+        stream.reset();
+    }
+
+    auto read_music(music_stream_t &stream, int16_t *output, const size_t frames) -> size_t {
+        const auto read = pop_n(stream.ring, output, frames * MUSIC_CHANNELS) / MUSIC_CHANNELS;
+        if (read == frames)
+            return read;
+
+        std::fill(output + read * MUSIC_CHANNELS, output + frames * MUSIC_CHANNELS, int16_t{0});
+
+        if (!stream.finished.load(std::memory_order_acquire)) {
+            stream.underruns.fetch_add(1, std::memory_order_relaxed);
+            stream.missing_frames.fetch_add(frames - read, std::memory_order_relaxed);
+        }
+
+        return read;
+    }
+
+    auto wait_music(const music_stream_t &stream, const size_t frames) -> void {
+        // Never more than the ring holds, the decoder can't get further ahead
+        const auto wanted = std::min(frames * MUSIC_CHANNELS, MUSIC_RING_SAMPLES - 1);
+
+        while (queued(stream.ring) < wanted && !stream.finished.load(std::memory_order_acquire))
+            std::this_thread::yield();
+    }
+
+    auto report_music_underruns(music_stream_t &stream) -> void {
+        const auto underruns = stream.underruns.load(std::memory_order_relaxed);
+        if (underruns == stream.reported_underruns)
+            return;
+
+        journal::warning("Music buffer ran dry %1 times, %2 frames of silence so far", underruns, stream.missing_frames.load(std::memory_order_relaxed));
+
+        stream.reported_underruns = underruns;
+    }
+
+} // namespace audio
@@ -0,0 +1,94 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <atomic>
+#include <thread>
+#include <vector>
+#include <memory>
+
+#include "spsc_queue.hh"
+
+#ifdef OGG_MUSIC
+#include <vorbis/vorbisfile.h>
+#endif // OGG_MUSIC
+
+typedef struct SDL_RWops SDL_RWops;
+
+// Long tracks are decoded a chunk at a time on their own thread, memory stays the same whatever the length
+
+namespace audio {
+
+    constexpr int MUSIC_FREQUENCY = 44100; // unless the backend asks for its device rate
+    constexpr int MUSIC_CHANNELS = 2;
+    constexpr size_t MUSIC_RING_SAMPLES = size_t{1} << 16; // about 0.75 s of interleaved stereo
+    constexpr size_t MUSIC_CHUNK_FRAMES = 4096;
+
+    enum class music_codec : uint32_t {
+        wav,
+        ogg
+    };
+
+    // Decoder thread only
+    typedef struct music_source_type {
+        music_source_type() = default;
+
+        SDL_RWops *rw = nullptr;
+        music_codec codec = music_codec::wav;
+        int frequency = 0;
+        int channels = 0;
+        int bits = 0;
+        int output_frequency = MUSIC_FREQUENCY;
+
+        // Data chunk of a wave file
+        int64_t data_offset = 0;
+        uint64_t data_size = 0;
+        uint64_t data_left = 0;
+
+#ifdef OGG_MUSIC
+        OggVorbis_File vorbis = {};
+#endif // OGG_MUSIC
+
+        // Linear resampler state, carried over chunk borders
+        double phase = 0.0;
+        int16_t last[MUSIC_CHANNELS] = {};
+
+        std::vector<uint8_t> raw;
+        std::vector<int16_t> frames; // stereo at the source rate
+        std::vector<int16_t> pending; // stereo at the output rate, waiting for room in the ring
+        size_t pending_offset = 0;
+    } music_source_t;
+
+    typedef struct music_stream_type {
+        music_stream_type() = default;
+
+        spsc_queue_t<int16_t, MUSIC_RING_SAMPLES> ring;
+        music_source_t source;
+        std::thread decoder;
+        bool looped = true;
+
+        std::atomic<bool> stop{false};
+        std::atomic<bool> finished{false}; // track is over, an empty ring is no longer an underrun
+
+        // Written by the consumer only
+        std::atomic<uint64_t> underruns{0};
+        std::atomic<uint64_t> missing_frames{0};
+
+        // Written by the game thread only
+        uint64_t reported_underruns = 0;
+    } music_stream_t;
+
+    // Takes the stream, a wave or ogg file, and starts decoding ahead, null if the format isn't supported
+    auto open_music(SDL_RWops *rw, const bool looped, const int frequency = MUSIC_FREQUENCY) -> std::unique_ptr<music_stream_t>;
+    auto close_music(std::unique_ptr<music_stream_t> &stream) -> void;
+
+    // Consumer side, never blocks, missing frames are filled with silence and counted as an underrun
+    auto read_music(music_stream_t &stream, int16_t *output, const size_t frames) -> size_t;
+
+    // Offline rendering, holds the caller until frames are decoded or the track is over, so no read comes up short
+    auto wait_music(const music_stream_t &stream, const size_t frames) -> void;
+
+    // Game thread, logs underruns seen since the last call
+    auto report_music_underruns(music_stream_t &stream) -> void;
+
+} // namespace audio
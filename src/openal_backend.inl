@@ -3,7 +3,6 @@ namespace audio {
     inline namespace al_backend {
 
         auto init(game::context_t &ctx) -> std::optional<context_t> {
-            (void)ctx;
             context_t a;
 
             //const auto default_device_name = alcGetString(nullptr, ALC_DEFAULT_DEVICE_SPECIFIER);
@@ -20,16 +19,40 @@ namespace audio {
 
             alGetError();
 
-            const auto context = alcCreateContext(device, nullptr);
+            // Refresh is how often the device mixes per second, the closest OpenAL gets to a buffer size
+            const auto requested = ctx.audio_format.frequency;
+            const ALCint attributes[] = {
+                ALC_FREQUENCY, requested,
+                ALC_REFRESH, std::max(1, requested / std::max(1, ctx.audio_format.buffer_frames)),
+                0
+            };
+
+            const auto context = alcCreateContext(device, attributes);
             if (!alcMakeContextCurrent(context)) {
                 journal::error("%1", "Failed to make default context\n");
                 return {};
             }
 
             a.audio_context = context;
+            a.device_stats = std::make_unique<callback_stats_t>();
+
+            // Sounds keep their channel layout, OpenAL plays mono and stereo buffers alike
+            ALCint frequency = 0;
+            ALCint refresh = 0;
+            alcGetIntegerv(device, ALC_FREQUENCY, 1, &frequency);
+            alcGetIntegerv(device, ALC_REFRESH, 1, &refresh);
+            ctx.audio_format.frequency = frequency > 0 ? frequency : requested;
+            ctx.audio_format.channels = 0;
+            if (refresh > 0)
+                ctx.audio_format.buffer_frames = ctx.audio_format.frequency / refresh;
+
+            journal::debug("Audio device opened, %1 Hz, %2 frames per update", ctx.audio_format.frequency, ctx.audio_format.buffer_frames);
 
             alGenSources(MAX_AUDIO_SOURCES, &a.sources[0]);
 
+            for (size_t i = 0; i < MAX_AUDIO_SOURCES; i++)
+                a.voices[i].source = a.sources[i];
+
             const float orientation[] = {0.0f, 0.0f, 1.0f, 0.0f, 1.0f, 0.0f };
 
             alListener3f(AL_POSITION, 0, 0, 1.0f);
@@ -40,6 +63,13 @@ namespace audio {
         }
 
         auto cleanup(context_t &ctx) -> void {
+            stop_music(ctx);
+
+            journal::info("Sounds played %1, voices stolen %2, sounds dropped %3", ctx.stats.played, ctx.stats.stolen, ctx.stats.dropped);
+
+            if (ctx.device_stats)
+                report_callback_stats(*ctx.device_stats);
+
             alDeleteSources(MAX_AUDIO_SOURCES, &ctx.sources[0]);
 
             alcMakeContextCurrent(nullptr);
@@ -48,27 +78,146 @@ namespace audio {
             alcCloseDevice(ctx.audio_device);
         }
 
-        auto play_sound(context_t &ctx, const resources::sound_t &sound, const bool looped) -> void {
+        static auto get_duration_ticks(const resources::sound_t &sound) -> uint64_t {
+            return static_cast<uint64_t>(static_cast<double>(resources::get_sound_duration(sound)) * static_cast<double>(SDL_GetPerformanceFrequency()));
+        }
+
+        // Free voice if any, otherwise the least important one: lowest priority, then quietest, then oldest
+        static auto allocate_voice(context_t &ctx, const int32_t priority, const uint64_t now) -> voice_t* {
+            voice_t *victim = nullptr;
+
+            for (auto &voice : ctx.voices) {
+                if (voice.end <= now)
+                    return &voice;
 
-            for (auto source : ctx.sources) {
-                ALint status = 0;
-                alGetSourcei(source, AL_SOURCE_STATE, &status);
+                if (!victim || voice.priority < victim->priority
+                        || (voice.priority == victim->priority && (voice.gain < victim->gain || (voice.gain == victim->gain && voice.start < victim->start))))
+                    victim = &voice;
+            }
+
+            if (!victim || victim->priority > priority)
+                return nullptr;
 
-                if ((status == AL_INITIAL) || (status == AL_STOPPED) || (status == 0)) {
-                    alSource3f(source, AL_POSITION, 0.0f, 0.0f, 0.0f);
-                    alSource3f(source, AL_VELOCITY, 0.0f, 0.0f, 0.0f);
-                    alSourcef(source, AL_PITCH, 1.0f);
-                    alSourcef(source, AL_GAIN, static_cast<float>(ctx.volume) / MAX_AUDIO_VOLUME);
+            ctx.stats.stolen++;
 
-                    if (looped != 0)
-                        alSourcei(source, AL_LOOPING, AL_TRUE);
+            return victim;
+        }
 
-                    alSourcei(source, AL_BUFFER, sound.buffer);
-                    alSourcePlay(source);
+        auto play_sound(context_t &ctx, const resources::sound_t &sound, const bool looped, const float gain) -> void {
+            const auto now = SDL_GetPerformanceCounter();
 
-                    break;
-                }
+            auto voice = allocate_voice(ctx, sound.priority, now);
+            if (!voice) {
+                ctx.stats.dropped++;
+                return;
             }
+
+            const auto source_gain = gain * static_cast<float>(ctx.volume) / MAX_AUDIO_VOLUME;
+            const auto source = voice->source;
+
+            voice->start = now;
+            voice->end = looped ? UINT64_MAX : now + get_duration_ticks(sound);
+            voice->priority = sound.priority;
+            voice->gain = source_gain;
+
+            // End times are counted from this call, not from when the device started the source, so a free voice may still
+            // be playing its last period. A buffer can't be swapped on a playing source, stopping is a command and always works.
+            alSourceStop(source);
+
+            alSource3f(source, AL_POSITION, 0.0f, 0.0f, 0.0f);
+            alSource3f(source, AL_VELOCITY, 0.0f, 0.0f, 0.0f);
+            alSourcef(source, AL_PITCH, 1.0f);
+            alSourcef(source, AL_GAIN, source_gain);
+            alSourcei(source, AL_LOOPING, looped ? AL_TRUE : AL_FALSE);
+            alSourcei(source, AL_BUFFER, sound.buffer);
+            alSourcePlay(source);
+
+            ctx.stats.played++;
+        }
+
+        // False once the track is over and nothing was left to queue
+        static auto queue_music_buffer(context_t &ctx, const uint32_t buffer) -> bool {
+            ctx.music_chunk.resize(MUSIC_CHUNK_FRAMES * MUSIC_CHANNELS);
+
+            const auto frames = read_music(*ctx.music, ctx.music_chunk.data(), MUSIC_CHUNK_FRAMES);
+            if (frames == 0 && ctx.music->finished.load(std::memory_order_acquire))
+                return false;
+
+            // A short read was padded with silence, the whole chunk is queued to keep the source going
+            alBufferData(buffer, AL_FORMAT_STEREO16, ctx.music_chunk.data(), static_cast<ALsizei>(ctx.music_chunk.size() * sizeof(int16_t)), MUSIC_FREQUENCY);
+            alSourceQueueBuffers(ctx.music_source, 1, &buffer);
+
+            return true;
+        }
+
+        auto play_music(context_t &ctx, SDL_RWops *rw, const bool looped) -> bool {
+            stop_music(ctx);
+
+            ctx.music = open_music(rw, looped);
+            if (!ctx.music)
+                return false;
+
+            alGenSources(1, &ctx.music_source);
+            alGenBuffers(MUSIC_BUFFERS, &ctx.music_buffers[0]);
+
+            alSourcef(ctx.music_source, AL_GAIN, static_cast<float>(ctx.volume) / MAX_AUDIO_VOLUME);
+
+            for (const auto buffer : ctx.music_buffers)
+                queue_music_buffer(ctx, buffer);
+
+            alSourcePlay(ctx.music_source);
+
+            return true;
+        }
+
+        auto stop_music(context_t &ctx) -> void {
+            if (!ctx.music)
+                return;
+
+            alSourceStop(ctx.music_source);
+            alSourcei(ctx.music_source, AL_BUFFER, 0);
+            alDeleteSources(1, &ctx.music_source);
+            alDeleteBuffers(MUSIC_BUFFERS, &ctx.music_buffers[0]);
+
+            ctx.music_source = 0;
+            ctx.music_buffers = {};
+
+            close_music(ctx.music);
+        }
+
+        auto update(context_t &ctx) -> void {
+            const auto now = SDL_GetPerformanceCounter();
+            const auto active = std::count_if(ctx.voices.begin(), ctx.voices.end(), [now] (const auto &v) {
+                return v.end > now;
+            });
+
+            record_voices(*ctx.device_stats, static_cast<uint32_t>(active));
+
+            if (!ctx.music)
+                return;
+
+            ALint processed = 0;
+            alGetSourcei(ctx.music_source, AL_BUFFERS_PROCESSED, &processed);
+
+            for (ALint i = 0; i < processed; i++) {
+                ALuint buffer = 0;
+                alSourceUnqueueBuffers(ctx.music_source, 1, &buffer);
+                queue_music_buffer(ctx, buffer);
+            }
+
+            // Source stops when every queued buffer got played before the next update, the frame was too long
+            ALint state = 0;
+            ALint queued = 0;
+            alGetSourcei(ctx.music_source, AL_SOURCE_STATE, &state);
+            alGetSourcei(ctx.music_source, AL_BUFFERS_QUEUED, &queued);
+
+            if (state != AL_PLAYING && queued > 0) {
+                ctx.music->underruns.fetch_add(1, std::memory_order_relaxed);
+                ctx.device_stats->underruns.fetch_add(1, std::memory_order_relaxed);
+                alSourcePlay(ctx.music_source);
+            }
+
+            report_music_underruns(*ctx.music);
         }
 
         auto enable_sound() -> void {
@@ -81,6 +230,9 @@ namespace audio {
 
         auto change_volume(context_t &ctx, int volume) -> void {
             ctx.volume = abs(volume) % MAX_AUDIO_VOLUME;
+
+            if (ctx.music)
+                alSourcef(ctx.music_source, AL_GAIN, static_cast<float>(ctx.volume) / MAX_AUDIO_VOLUME);
         }
 
     } // namespace al_backend
@@ -106,12 +258,21 @@ namespace resources {
         return AL_NONE;
     }
 
+    auto get_sound_duration(const sound_t &snd) -> float {
+        const auto bytes_per_frame = (snd.format == AL_FORMAT_STEREO16) ? 4 : (snd.format == AL_FORMAT_MONO8) ? 1 : 2;
+        if (snd.frequency <= 0)
+            return 0.0f;
+
+        return static_cast<float>(snd.size / bytes_per_frame) / static_cast<float>(snd.frequency);
+    }
+
     auto create_sound(const wave_t &wave) -> std::optional<sound_t> {
         ALuint buf = 0;
         ALenum format = convert_audio_format(wave.format);
 
         alGenBuffers(1, &buf);
-        alBufferData(buf, format, &wave.bytes[0], wave.size, wave.frequency);
+        const auto data = wave.view ? wave.view : wave.bytes.data() + wave.offset;
+        alBufferData(buf, format, data, static_cast<ALsizei>(wave.size), wave.frequency);
 
         sound_t snd;
         snd.buffer = buf;
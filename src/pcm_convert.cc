@@ -0,0 +1,378 @@
+#include <cmath>
+#include <cstring>
+#include <numeric>
+#include <algorithm>
+#include <optional>
+
+#include <SDL2/SDL_rwops.h>
+
+#include "pcm_convert.hh"
+
+namespace audio {
+
+    constexpr size_t RESAMPLER_TAPS = 32; // at unity ratio, downsampling widens the filter
+    constexpr size_t RESAMPLER_MAX_TAPS = 256;
+    constexpr uint64_t RESAMPLER_MAX_PHASES = 1024;
+    constexpr double RESAMPLER_CUTOFF = 0.94; // of the lower Nyquist, leaves room for the transition band
+    constexpr double RESAMPLER_KAISER_BETA = 8.6;
+
+    // Polyphase windowed sinc for an exact up/down ratio, one row of taps per output phase
+    typedef struct resampler_type {
+        resampler_type() = default;
+
+        uint64_t up = 1;
+        uint64_t down = 1;
+        uint64_t phases = 1;
+        size_t taps = 0; // a multiple of 8, so rows are walked eight lanes at a time
+        std::vector<float> coeffs;
+    } resampler_t;
+
+    static auto get_sample_size(const sample_format format) -> size_t {
+        switch (format) {
+        case sample_format::u8:
+            return 1;
+        case sample_format::s16:
+            return 2;
+        case sample_format::s32:
+        case sample_format::f32:
+            return 4;
+        }
+
+        return 0;
+    }
+
+    static auto read_sample(const uint8_t *p, const sample_format format) -> float {
+        switch (format) {
+        case sample_format::u8:
+            return static_cast<float>(p[0] - 128) / 128.0f;
+        case sample_format::s16:
+            return static_cast<float>(static_cast<int16_t>(p[0] | (p[1] << 8))) / 32768.0f;
+        case sample_format::s32: {
+            const auto v = static_cast<uint32_t>(p[0]) | (static_cast<uint32_t>(p[1]) << 8) | (static_cast<uint32_t>(p[2]) << 16) | (static_cast<uint32_t>(p[3]) << 24);
+            return static_cast<float>(static_cast<int32_t>(v)) / 2147483648.0f;
+        }
+        case sample_format::f32: {
+            float v = 0.0f;
+            memcpy(&v, p, sizeof v);
+            return v;
+        }
+        }
+
+        return 0.0f;
+    }
+
+    // Zeroth order modified Bessel function, for the Kaiser window
+    static auto bessel_i0(const double x) -> double {
+        auto sum = 1.0;
+        auto term = 1.0;
+        for (int k = 1; k < 32; k++) {
+            term *= (x / (2.0 * k)) * (x / (2.0 * k));
+            sum += term;
+        }
+
+        return sum;
+    }
+
+    static auto create_resampler(const int from, const int to) -> resampler_t {
+        resampler_t rs;
+
+        const auto g = std::gcd(from, to);
+        rs.up = static_cast<uint64_t>(to / g);
+        rs.down = static_cast<uint64_t>(from / g);
+        rs.phases = std::min(rs.up, RESAMPLER_MAX_PHASES);
+
+        // Downsampling lowers the cutoff below the input Nyquist, more taps keep the transition as steep
+        const auto ratio = std::min(1.0, static_cast<double>(rs.up) / static_cast<double>(rs.down));
+        const auto cutoff = RESAMPLER_CUTOFF * ratio;
+        const auto taps = std::min(RESAMPLER_MAX_TAPS, static_cast<size_t>(std::ceil(static_cast<double>(RESAMPLER_TAPS) / ratio)));
+
+        rs.taps = (taps + 7) & ~size_t{7};
+        rs.coeffs.resize(rs.phases * rs.taps);
+
+        const auto half = static_cast<double>(rs.taps / 2);
+        const auto norm = bessel_i0(RESAMPLER_KAISER_BETA);
+
+        for (uint64_t p = 0; p < rs.phases; p++) {
+            const auto frac = static_cast<double>(p) / static_cast<double>(rs.phases);
+            auto row = &rs.coeffs[p * rs.taps];
+
+            auto sum = 0.0;
+            for (size_t k = 0; k < rs.taps; k++) {
+                // Distance of this tap from the output point, in input samples
+                const auto t = static_cast<double>(k) - half + 1.0 - frac;
+                const auto x = t / half;
+                const auto window = std::abs(x) < 1.0 ? bessel_i0(RESAMPLER_KAISER_BETA * std::sqrt(1.0 - x * x)) / norm : 0.0;
+                const auto arg = M_PI * cutoff * t;
+                const auto sinc = std::abs(arg) < 1e-9 ? 1.0 : std::sin(arg) / arg;
+                const auto h = cutoff * sinc * window;
+
+                row[k] = static_cast<float>(h);
+                sum += h;
+            }
+
+            // Unity gain at DC for every phase, otherwise the phases ripple audibly
+            for (size_t k = 0; k < rs.taps; k++)
+                row[k] = static_cast<float>(row[k] / sum);
+        }
+
+        return rs;
+    }
+
+    // Eight independent sums, a dependency free shape the compiler turns into vector multiply-adds
+    static auto dot(const float *a, const float *b, const size_t n) -> float {
+        float acc[8] = {};
+        for (size_t k = 0; k < n; k += 8)
+            for (size_t j = 0; j < 8; j++)
+                acc[j] += a[k + j] * b[k + j];
+
+        return ((acc[0] + acc[4]) + (acc[1] + acc[5])) + ((acc[2] + acc[6]) + (acc[3] + acc[7]));
+    }
+
+    // Input carries taps of silence on both sides, so no tap is ever out of bounds
+    static auto resample(const resampler_t &rs, const std::vector<float> &padded, const size_t frames, std::vector<float> &output) -> void {
+        const auto out_frames = (frames * rs.up + rs.down - 1) / rs.down;
+        output.resize(out_frames);
+
+        const auto origin = padded.data() + rs.taps - rs.taps / 2 + 1;
+
+        for (size_t n = 0; n < out_frames; n++) {
+            const auto position = n * rs.down;
+            const auto index = position / rs.up;
+            const auto phase = (position % rs.up) * rs.phases / rs.up;
+
+            output[n] = dot(&rs.coeffs[phase * rs.taps], origin + index, rs.taps);
+        }
+    }
+
+    auto get_output_channels(const pcm_spec_t &from, const device_format_t &to) -> int {
+        return to.channels != 0 ? to.channels : std::min(from.channels, 2);
+    }
+
+    auto convert_pcm(const uint8_t *data, const size_t size, const pcm_spec_t &from, const device_format_t &to) -> std::vector<int16_t> {
+        const auto sample_size = get_sample_size(from.format);
+        if (!data || from.channels <= 0 || from.frequency <= 0 || to.frequency <= 0 || sample_size == 0)
+            return {};
+
+        const auto in_channels = static_cast<size_t>(from.channels);
+        const auto out_channels = static_cast<size_t>(get_output_channels(from, to));
+        const auto frame_size = sample_size * in_channels;
+        const auto frames = size / frame_size;
+
+        const auto same_rate = from.frequency == to.frequency;
+        const auto rs = same_rate ? resampler_t{} : create_resampler(from.frequency, to.frequency);
+        const auto pad = rs.taps;
+
+        std::vector<float> planar(frames + pad * 2);
+        std::vector<float> resampled;
+        std::vector<int16_t> output;
+
+        for (size_t c = 0; c < out_channels; c++) {
+            // Mono output averages every channel, stereo from mono repeats it, extra channels are dropped
+            for (size_t i = 0; i < frames; i++) {
+                const auto frame = data + i * frame_size;
+
+                auto v = 0.0f;
+                if (out_channels == 1) {
+                    for (size_t s = 0; s < in_channels; s++)
+                        v += read_sample(frame + s * sample_size, from.format);
+                    v /= static_cast<float>(in_channels);
+                } else {
+                    v = read_sample(frame + std::min(c, in_channels - 1) * sample_size, from.format);
+                }
+
+                planar[pad + i] = v;
+            }
+
+            const auto *samples = planar.data() + pad;
+            auto count = frames;
+
+            if (!same_rate) {
+                resample(rs, planar, frames, resampled);
+                samples = resampled.data();
+                count = resampled.size();
+            }
+
+            output.resize(count * out_channels);
+
+            for (size_t i = 0; i < count; i++) {
+                const auto v = std::clamp(samples[i] * 32768.0f, -32768.0f, 32767.0f);
+                output[i * out_channels + c] = static_cast<int16_t>(std::lrint(v));
+            }
+        }
+
+        return output;
+    }
+
+    constexpr uint16_t WAVE_FORMAT_PCM = 0x0001;
+    constexpr uint16_t WAVE_FORMAT_IEEE_FLOAT = 0x0003;
+    constexpr uint16_t WAVE_FORMAT_EXTENSIBLE = 0xfffe;
+
+    static auto read_le16(const uint8_t *p) -> uint16_t {
+        return static_cast<uint16_t>(p[0] | (p[1] << 8));
+    }
+
+    static auto read_le32(const uint8_t *p) -> uint32_t {
+        return static_cast<uint32_t>(p[0]) | (static_cast<uint32_t>(p[1]) << 8) | (static_cast<uint32_t>(p[2]) << 16) | (static_cast<uint32_t>(p[3]) << 24);
+    }
+
+    // Bits is the container size, 24 bit samples padded to 32 read as 32
+    static auto get_sample_format(const uint16_t tag, const uint16_t bits) -> std::optional<sample_format> {
+        if (tag == WAVE_FORMAT_PCM) {
+            switch (bits) {
+            case 8:
+                return sample_format::u8;
+            case 16:
+                return sample_format::s16;
+            case 32:
+                return sample_format::s32;
+            }
+        }
+
+        if (tag == WAVE_FORMAT_IEEE_FLOAT && bits == 32)
+            return sample_format::f32;
+
+        return {};
+    }
+
+    static auto parse_format_chunk(const uint8_t *chunk, const size_t size) -> std::optional<pcm_spec_t> {
+        if (size < 16)
+            return {};
+
+        auto tag = read_le16(chunk);
+        const auto channels = read_le16(chunk + 2);
+        const auto frequency = read_le32(chunk + 4);
+        const auto block_align = read_le16(chunk + 12);
+        const auto bits = read_le16(chunk + 14);
+
+        // Extensible keeps the real tag in the first two bytes of its sub format GUID
+        if (tag == WAVE_FORMAT_EXTENSIBLE) {
+            if (size < 40)
+                return {};
+
+            tag = read_le16(chunk + 24);
+        }
+
+        const auto format = get_sample_format(tag, bits);
+        if (!format || channels == 0 || frequency == 0 || frequency > INT32_MAX || block_align != channels * get_sample_size(format.value()))
+            return {};
+
+        pcm_spec_t spec;
+        spec.frequency = static_cast<int>(frequency);
+        spec.channels = channels;
+        spec.format = format.value();
+
+        return spec;
+    }
+
+    // One walk for memory and streams, read fills a buffer from an offset into the file and fails past its end
+    template<typename Read>
+    static auto walk_wave(const size_t size, Read &&read) -> std::optional<wave_layout_t> {
+        uint8_t riff[12];
+        if (size < sizeof riff || !read(0, riff, sizeof riff) || memcmp(riff, "RIFF", 4) != 0 || memcmp(riff + 8, "WAVE", 4) != 0)
+            return {};
+
+        // Streaming writers leave the sizes at zero or too large, the file is what really bounds the walk
+        const auto riff_size = static_cast<size_t>(read_le32(riff + 4));
+        const auto end = riff_size >= 4 && riff_size <= size - 8 ? riff_size + 8 : size;
+
+        std::optional<pcm_spec_t> spec;
+        std::optional<size_t> data_offset;
+        size_t data_size = 0;
+
+        auto offset = size_t{12};
+        while (offset + 8 <= end && !(spec && data_offset)) {
+            uint8_t chunk[8];
+            if (!read(offset, chunk, sizeof chunk))
+                return {};
+
+            const auto chunk_size = static_cast<size_t>(read_le32(chunk + 4));
+            const auto body = offset + 8;
+            const auto available = std::min(chunk_size, end - body);
+
+            if (memcmp(chunk, "fmt ", 4) == 0) {
+                // Nothing past the extensible part is used
+                uint8_t format[40];
+                const auto length = std::min(available, sizeof format);
+
+                spec = read(body, format, length) ? parse_format_chunk(format, length) : std::nullopt;
+                if (!spec)
+                    return {};
+            } else if (memcmp(chunk, "data", 4) == 0 && !data_offset) {
+                // A cut off file keeps what made it
+                data_offset = body;
+                data_size = available;
+            }
+
+            if (chunk_size >= end - body)
+                break;
+
+            // Chunks are word aligned, an odd size is followed by a pad byte
+            offset = body + chunk_size + (chunk_size & 1);
+        }
+
+        if (!spec || !data_offset)
+            return {};
+
+        const auto frame_size = get_sample_size(spec.value().format) * static_cast<size_t>(spec.value().channels);
+
+        wave_layout_t layout;
+        layout.spec = spec.value();
+        layout.data_offset = data_offset.value();
+        layout.data_size = data_size / frame_size * frame_size;
+
+        return layout;
+    }
+
+    auto parse_wave(const uint8_t *data, const size_t size) -> std::optional<wave_span_t> {
+        if (!data)
+            return {};
+
+        const auto layout = walk_wave(size, [data] (const size_t offset, uint8_t *output, const size_t count) {
+            memcpy(output, data + offset, count);
+            return true;
+        });
+
+        if (!layout)
+            return {};
+
+        wave_span_t span;
+        span.spec = layout.value().spec;
+        span.data = data + layout.value().data_offset;
+        span.size = layout.value().data_size;
+
+        return span;
+    }
+
+    auto parse_wave(SDL_RWops *rw) -> std::optional<wave_layout_t> {
+        const auto size = rw ? SDL_RWsize(rw) : -1;
+        if (size < 0)
+            return {};
+
+        return walk_wave(static_cast<size_t>(size), [rw] (const size_t offset, uint8_t *output, const size_t count) {
+            const auto position = static_cast<Sint64>(offset);
+            return SDL_RWseek(rw, position, RW_SEEK_SET) == position && (count == 0 || SDL_RWread(rw, output, count, 1) == 1);
+        });
+    }
+
+    auto load_pcm_wave(const uint8_t *data, const size_t size, const device_format_t &to, int &channels) -> std::vector<int16_t> {
+        const auto span = parse_wave(data, size);
+        if (!span)
+            return {};
+
+        channels = get_output_channels(span.value().spec, to);
+
+        return convert_pcm(span.value().data, span.value().size, span.value().spec, to);
+    }
+
+    auto load_pcm_wave(SDL_RWops *rw, const device_format_t &to, int &channels) -> std::vector<int16_t> {
+        if (!rw)
+            return {};
+
+        std::vector<uint8_t> bytes(static_cast<size_t>(std::max<Sint64>(SDL_RWsize(rw), 0)));
+        const auto read = !bytes.empty() && SDL_RWread(rw, bytes.data(), bytes.size(), 1) == 1;
+        SDL_RWclose(rw);
+
+        return read ? load_pcm_wave(bytes.data(), bytes.size(), to, channels) : std::vector<int16_t>{};
+    }
+
+} // namespace audio
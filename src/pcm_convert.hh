@@ -0,0 +1,74 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <optional>
+#include <vector>
+
+typedef struct SDL_RWops SDL_RWops;
+
+// Sounds are converted once when loaded, so the mixers only ever see int16 at the device rate
+
+namespace audio {
+
+    enum class sample_format : uint32_t {
+        u8,
+        s16,
+        s32,
+        f32
+    };
+
+    // Layout of decoded wave data, little endian
+    typedef struct pcm_spec_type {
+        pcm_spec_type() = default;
+
+        int frequency = 0;
+        int channels = 0;
+        sample_format format = sample_format::s16;
+    } pcm_spec_t;
+
+    // Asked for from game.conf before the device opens, what it really got afterwards, samples are always int16
+    typedef struct device_format_type {
+        device_format_type() = default;
+
+        int frequency = 44100;
+        int channels = 2; // 0 keeps the layout of the source
+        int buffer_frames = 1024; // per callback, the latency floor
+    } device_format_t;
+
+    // Samples of a wave file in memory, data points into the buffer it was parsed from
+    typedef struct wave_span_type {
+        wave_span_type() = default;
+
+        pcm_spec_t spec;
+        const uint8_t *data = nullptr;
+        size_t size = 0; // whole frames only
+    } wave_span_t;
+
+    // Where the samples of a wave file are, as offsets from its start
+    typedef struct wave_layout_type {
+        wave_layout_type() = default;
+
+        pcm_spec_t spec;
+        size_t data_offset = 0;
+        size_t data_size = 0; // whole frames only
+    } wave_layout_t;
+
+    // Walks the RIFF chunks in any order, PCM, float and extensible formats, without copying anything
+    auto parse_wave(const uint8_t *data, const size_t size) -> std::optional<wave_span_t>;
+
+    // Same walk over a seekable stream, only chunk headers and the format are read, the position is left anywhere
+    auto parse_wave(SDL_RWops *rw) -> std::optional<wave_layout_t>;
+
+    auto get_output_channels(const pcm_spec_t &from, const device_format_t &to) -> int;
+
+    // Interleaved int16 frames in the device format, empty when the spec is unusable
+    auto convert_pcm(const uint8_t *data, const size_t size, const pcm_spec_t &from, const device_format_t &to) -> std::vector<int16_t>;
+
+    // Wave file converted as above, reports the channels it ended up with
+    auto load_pcm_wave(const uint8_t *data, const size_t size, const device_format_t &to, int &channels) -> std::vector<int16_t>;
+
+    // Same from a stream, which is read whole and closed
+    auto load_pcm_wave(SDL_RWops *rw, const device_format_t &to, int &channels) -> std::vector<int16_t>;
+
+} // namespace audio
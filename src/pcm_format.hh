@@ -0,0 +1,20 @@
+#pragma once
+
+#include <cstdint>
+
+// Converted sounds cached by sound_converter next to the source: header, then interleaved int16 frames
+
+constexpr char PCM_MAGIC[4] = {'A', 'R', 'K', 'S'};
+constexpr uint32_t PCM_VERSION = 1;
+
+#pragma pack(push, pcm_align)
+#pragma pack(1)
+typedef struct PcmHeader
+{
+    char        magic[4];
+    uint32_t    version;
+    uint32_t    frequency;
+    uint32_t    channels;
+    uint64_t    frames;
+} PCM_HEADER;
+#pragma pack(pop, pcm_align)
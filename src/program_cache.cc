@@ -0,0 +1,168 @@
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cerrno>
+
+#ifdef __unix__
+#include <sys/stat.h>
+#include <sys/types.h>
+#endif
+
+#include <SDL2/SDL.h>
+#include <GL/glcore.h>
+
+#include "journal.hh"
+#include "utils.hh"
+#include "program_cache.hh"
+
+namespace resources {
+
+    constexpr char PROGRAM_CACHE_MAGIC[4] = {'A', 'R', 'K', 'P'};
+    constexpr uint32_t PROGRAM_CACHE_VERSION = 1;
+
+#pragma pack(push, program_cache_align)
+#pragma pack(1)
+    struct program_cache_header {
+        char        magic[4];
+        uint32_t    version;
+        uint64_t    key;
+        uint32_t    format;
+        uint32_t    size;
+    };
+#pragma pack(pop, program_cache_align)
+
+    static auto make_dirs(const std::string &path) -> bool {
+#ifdef __unix__
+        for (size_t pos = path.find('/', 1); ; pos = path.find('/', pos + 1)) {
+            const auto dir = path.substr(0, pos);
+            if (mkdir(dir.c_str(), 0755) != 0 && errno != EEXIST)
+                return false;
+
+            if (pos == std::string::npos)
+                break;
+        }
+
+        return true;
+#else
+        (void)path;
+        return false;
+#endif
+    }
+
+    static auto get_cache_path(const std::string_view cache_dir, const uint64_t key) -> std::string {
+        char name[32] = {};
+        snprintf(name, sizeof name, "%016llx.bin", static_cast<unsigned long long>(key));
+
+        return std::string{cache_dir} + "/" + name;
+    }
+
+    auto get_cache_dir() -> std::string {
+        constexpr char app_dir[] = "arkanoid2k18";
+
+        if (const auto xdg = getenv("XDG_CACHE_HOME"); xdg && *xdg) {
+            const auto path = std::string{xdg} + "/" + app_dir;
+            if (make_dirs(path))
+                return path;
+        }
+
+        if (const auto home = getenv("HOME"); home && *home) {
+            const auto path = std::string{home} + "/.cache/" + app_dir;
+            if (make_dirs(path))
+                return path;
+        }
+
+        // SDL creates this directory for us
+        if (auto pref = SDL_GetPrefPath("m1nuz", app_dir); pref) {
+            std::string path{pref};
+            SDL_free(pref);
+
+            if (!path.empty() && path.back() == '/')
+                path.pop_back();
+
+            return path;
+        }
+
+        return {};
+    }
+
+    auto get_program_key(const std::string_view vert_source, const std::string_view frag_source) -> uint64_t {
+        const auto gl_string = [] (const GLenum name) {
+            const auto str = reinterpret_cast<const char*>(glGetString(name));
+            return std::string_view{str ? str : ""};
+        };
+
+        auto key = hash_fnv1a(vert_source);
+        key = hash_fnv1a("\0", 1, key);
+        key = hash_fnv1a(frag_source, key);
+        key = hash_fnv1a(gl_string(GL_VENDOR), key);
+        key = hash_fnv1a(gl_string(GL_RENDERER), key);
+        key = hash_fnv1a(gl_string(GL_VERSION), key);
+
+        return key;
+    }
+
+    auto load_program_binary(const std::string_view cache_dir, const uint64_t key) -> std::optional<program_binary_t> {
+        if (cache_dir.empty())
+            return {};
+
+        const auto path = get_cache_path(cache_dir, key);
+
+        auto fp = fopen(path.c_str(), "rb");
+        if (!fp)
+            return {};
+
+        program_cache_header header;
+        if (fread(&header, sizeof header, 1, fp) != 1
+                || memcmp(header.magic, PROGRAM_CACHE_MAGIC, sizeof header.magic) != 0
+                || header.version != PROGRAM_CACHE_VERSION
+                || header.key != key) {
+            fclose(fp);
+            return {};
+        }
+
+        program_binary_t binary;
+        binary.format = header.format;
+        binary.bytes.resize(header.size);
+
+        const auto readen = header.size == 0 ? 0 : fread(&binary.bytes[0], header.size, 1, fp);
+        fclose(fp);
+
+        if (readen != 1)
+            return {};
+
+        return binary;
+    }
+
+    auto save_program_binary(const std::string_view cache_dir, const uint64_t key, const program_binary_t &binary) -> bool {
+        if (cache_dir.empty() || binary.bytes.empty())
+            return false;
+
+        const auto path = get_cache_path(cache_dir, key);
+        const auto temp_path = path + ".tmp";
+
+        auto fp = fopen(temp_path.c_str(), "wb");
+        if (!fp) {
+            journal::warning("Can't write program cache '%1'", temp_path);
+            return false;
+        }
+
+        program_cache_header header;
+        memcpy(header.magic, PROGRAM_CACHE_MAGIC, sizeof header.magic);
+        header.version = PROGRAM_CACHE_VERSION;
+        header.key = key;
+        header.format = binary.format;
+        header.size = static_cast<uint32_t>(binary.bytes.size());
+
+        const auto written = fwrite(&header, sizeof header, 1, fp) == 1 && fwrite(&binary.bytes[0], binary.bytes.size(), 1, fp) == 1;
+        fclose(fp);
+
+        // Rename is atomic, so a crash never leaves a truncated binary behind
+        if (!written || rename(temp_path.c_str(), path.c_str()) != 0) {
+            remove(temp_path.c_str());
+            return false;
+        }
+
+        return true;
+    }
+
+} // namespace resources
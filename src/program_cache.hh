@@ -0,0 +1,25 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <optional>
+#include <vector>
+
+namespace resources {
+
+    typedef struct program_binary_type {
+        program_binary_type() = default;
+
+        uint32_t format = 0;
+        std::vector<uint8_t> bytes;
+    } program_binary_t;
+
+    auto get_cache_dir() -> std::string;
+
+    // Key depends on sources and driver, so an updated driver never gets a stale binary
+    auto get_program_key(const std::string_view vert_source, const std::string_view frag_source) -> uint64_t;
+
+    auto load_program_binary(const std::string_view cache_dir, const uint64_t key) -> std::optional<program_binary_t>;
+    auto save_program_binary(const std::string_view cache_dir, const uint64_t key, const program_binary_t &binary) -> bool;
+
+} // namespace resources
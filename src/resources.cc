@@ -1,4 +1,3 @@
-#include <json.hpp>
 #include <GL/glcore.h>
 
 #include "config.hh"
@@ -6,13 +5,21 @@
 #include "resources.hh"
 #include "game.hh"
 #include "audio.hh"
-
-#include "texture_format.inl"
-
-using json = nlohmann::json;
+#include "program_cache.hh"
+#include "upload_queue.hh"
+#include "texture_cache.hh"
+#include "archive.hh"
+#include "worker_pool.hh"
+#include "manifest.hh"
+#include "trace.hh"
 
 auto load_targa(SDL_RWops *rw) -> std::optional<resources::image_t>;
-auto load_wave(SDL_RWops *rw) -> std::optional<resources::wave_t>;
+auto decode_targa(const uint8_t *data, const size_t size, const bool swizzle) -> std::optional<resources::image_t>;
+auto load_dds(SDL_RWops *rw) -> std::optional<resources::image_t>;
+auto load_wave(const uint8_t *data, const size_t size, const audio::device_format_t &format) -> std::optional<resources::wave_t>;
+auto load_wave(std::vector<uint8_t> file, const audio::device_format_t &format) -> std::optional<resources::wave_t>;
+auto load_converted_wave(const uint8_t *data, const size_t size, const audio::device_format_t &format) -> std::optional<resources::wave_t>;
+auto load_converted_wave(std::vector<uint8_t> file, const audio::device_format_t &format) -> std::optional<resources::wave_t>;
 
 namespace resources {
 
@@ -116,8 +123,59 @@ namespace resources {
         }
     }
 
-    static auto compile(const std::string_view vert_source, const std::string_view frag_source, const std::string_view geom_source = {}) -> std::optional<shader_t> {
-        (void)geom_source;
+    static auto load_cached_program(const std::string_view cache_dir, const uint64_t key) -> std::optional<shader_t> {
+        const auto binary = load_program_binary(cache_dir, key);
+        if (!binary)
+            return {};
+
+        shader_t sh;
+        sh.id = glCreateProgram();
+
+        glProgramBinary(sh.id, binary.value().format, &binary.value().bytes[0], static_cast<GLsizei>(binary.value().bytes.size()));
+
+        GLint status = 0;
+        glGetProgramiv(sh.id, GL_LINK_STATUS, &status);
+
+        // Driver rejects binaries it can't use, recompile from source then
+        if (!status) {
+            journal::debug("Program binary %1 rejected", key);
+            glDeleteProgram(sh.id);
+            return {};
+        }
+
+        get_program_uniforms(sh);
+        get_program_attributes(sh);
+
+        return sh;
+    }
+
+    static auto store_cached_program(const std::string_view cache_dir, const uint64_t key, const shader_t &sh) -> void {
+        GLint lenght = 0;
+        glGetProgramiv(sh.id, GL_PROGRAM_BINARY_LENGTH, &lenght);
+
+        if (lenght <= 0)
+            return;
+
+        program_binary_t binary;
+        binary.bytes.resize(lenght);
+
+        GLsizei written = 0;
+        GLenum format = GL_ZERO;
+        glGetProgramBinary(sh.id, lenght, &written, &format, &binary.bytes[0]);
+        binary.bytes.resize(written);
+        binary.format = format;
+
+        if (!save_program_binary(cache_dir, key, binary))
+            journal::warning("Can't cache program binary %1", key);
+    }
+
+    static auto compile(const std::string_view vert_source, const std::string_view frag_source, const std::string_view cache_dir = {}) -> std::optional<shader_t> {
+        const auto key = cache_dir.empty() ? 0ull : get_program_key(vert_source, frag_source);
+
+        if (!cache_dir.empty()) {
+            if (const auto sh = load_cached_program(cache_dir, key); sh)
+                return sh;
+        }
 
         shader_t sh;
         sh.id = glCreateProgram();
@@ -128,6 +186,9 @@ namespace resources {
         glAttachShader(sh.id, vs);
         glAttachShader(sh.id, fs);
 
+        if (!cache_dir.empty())
+            glProgramParameteri(sh.id, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+
         if (!link_program(sh.id)) {
             glDeleteProgram(sh.id);
             sh.id = 0;
@@ -138,136 +199,324 @@ namespace resources {
         get_program_uniforms(sh);
         get_program_attributes(sh);
 
+        if (!cache_dir.empty())
+            store_cached_program(cache_dir, key, sh);
+
         return sh;
     }
 
-    static auto create_texture(const image_t &image, const bool mipmaps = true) -> std::optional<texture_t> {
-        auto id = 0u;
-        glGenTextures(1, &id);
-        glBindTexture(GL_TEXTURE_2D, id);
+    static auto has_extension(const std::string_view name) -> bool {
+        GLint total = 0;
+        glGetIntegerv(GL_NUM_EXTENSIONS, &total);
+
+        for (auto i = 0; i < total; i++) {
+            const auto ext = reinterpret_cast<const char*>(glGetStringi(GL_EXTENSIONS, static_cast<GLuint>(i)));
+            if (ext && name == ext)
+                return true;
+        }
+
+        return false;
+    }
+
+    // Compressed copy made by texture_compressor lives next to the source image
+    static auto load_compressed_image(const archive_t &archive, const std::string &name) -> std::optional<image_t> {
+        const auto dot = name.rfind('.');
+        const auto dds_name = (dot == std::string::npos ? name : name.substr(0, dot)) + ".dds";
+
+        auto rw = open_asset(archive, dds_name);
+        if (!rw)
+            return {};
+
+        return load_dds(rw);
+    }
+
+    typedef struct decode_task_type {
+        decode_task_type() = default;
+
+        std::string name;
+        std::string source;
+        bool stream = false;
+        int32_t priority = 0;
+
+        std::optional<image_t> image;
+        std::optional<wave_t> wave;
+        std::string error;
+        uint64_t ticks = 0;
+    } decode_task_t;
+
+    static auto get_milliseconds(const uint64_t ticks) -> double {
+        return static_cast<double>(ticks) * 1000.0 / static_cast<double>(SDL_GetPerformanceFrequency());
+    }
+
+    // Runs on a worker thread, everything it reports goes into the task
+    static auto decode_texture(const archive_t &archive, const bool s3tc_supported, decode_task_t &task) -> void {
+        const trace::scope_t scope{task.name};
+        const auto start = SDL_GetPerformanceCounter();
+
+        task.image = s3tc_supported ? load_compressed_image(archive, task.source) : std::optional<image_t>{};
+
+        // Packed images are decoded straight from the mapping
+        if (!task.image) {
+            if (const auto blob = find_blob(archive, task.source); blob) {
+                task.image = decode_targa(blob.value().data, blob.value().size, false);
+                if (!task.image)
+                    task.error = "bad image";
+            } else if (auto rw = open_asset(archive, task.source); rw) {
+                task.image = load_targa(rw);
+                if (!task.image)
+                    task.error = "bad image";
+            } else {
+                task.error = SDL_GetError();
+            }
+        }
 
-        const auto w = static_cast<GLsizei>(image.width);
-        const auto h = static_cast<GLsizei>(image.height);
+        task.ticks = SDL_GetPerformanceCounter() - start;
+    }
 
-        auto internal_format = static_cast<GLint >(0);
-        auto format = static_cast<GLenum>(0);
-        auto type = static_cast<GLenum>(0);
-        get_texture_format_from_pixelformat(image.format, internal_format, format, type);
+    // Whole loose file, for assets that aren't packed
+    static auto read_asset(const archive_t &archive, const std::string_view name) -> std::optional<std::vector<uint8_t>> {
+        auto rw = open_asset(archive, name);
+        if (!rw)
+            return {};
 
-        const auto pixels = image.pixels.empty() ? nullptr : reinterpret_cast<const void*>(&image.pixels[0]);
+        std::vector<uint8_t> bytes(static_cast<size_t>(std::max<Sint64>(SDL_RWsize(rw), 0)));
+        const auto read = bytes.empty() || SDL_RWread(rw, bytes.data(), bytes.size(), 1) == 1;
+        SDL_RWclose(rw);
 
-        glTexImage2D(GL_TEXTURE_2D, 0, internal_format, static_cast<int32_t>(w), static_cast<int32_t>(h), 0, format, type, pixels);
+        if (!read)
+            return {};
 
-        if (mipmaps)
-            glGenerateMipmap(GL_TEXTURE_2D);
+        return bytes;
+    }
 
-        glBindTexture(GL_TEXTURE_2D, 0);
+    // Copy made by sound_converter for this device rate, packed copies are read straight from the mapping
+    static auto load_converted_sound(const archive_t &archive, const std::string &name, const audio::device_format_t &format) -> std::optional<wave_t> {
+        const auto dot = name.rfind('.');
+        const auto pcm_name = (dot == std::string::npos ? name : name.substr(0, dot)) + "." + std::to_string(format.frequency) + ".pcm";
 
-        return texture_t{id, GL_TEXTURE_2D, image.width, image.height, 0};
-    }    
+        if (const auto blob = find_blob(archive, pcm_name); blob)
+            return load_converted_wave(blob.value().data, blob.value().size, format);
+
+        if (auto bytes = read_asset(archive, pcm_name); bytes)
+            return load_converted_wave(std::move(bytes.value()), format);
+
+        return {};
+    }
+
+    static auto decode_sound(const archive_t &archive, const audio::device_format_t &format, decode_task_t &task) -> void {
+        const trace::scope_t scope{task.name};
+        const auto start = SDL_GetPerformanceCounter();
+
+        // Source is only converted when there is no cached copy for this device
+        task.wave = load_converted_sound(archive, task.source, format);
+
+        if (!task.wave) {
+            if (const auto blob = find_blob(archive, task.source); blob) {
+                task.wave = load_wave(blob.value().data, blob.value().size, format);
+                if (!task.wave)
+                    task.error = "bad sound";
+            } else if (auto bytes = read_asset(archive, task.source); bytes) {
+                task.wave = load_wave(std::move(bytes.value()), format);
+                if (!task.wave)
+                    task.error = "bad sound";
+            } else {
+                task.error = SDL_GetError();
+            }
+        }
+
+        task.ticks = SDL_GetPerformanceCounter() - start;
+    }
 
     auto init(game::context_t &ctx, const std::string_view assets_path) -> bool {
         using namespace std;
 
-        auto contents = get_config(assets_path);
-        if (!contents) {
+        auto file = map_file(assets_path);
+        if (!file) {
             journal::critical("%1", "Can't read asset config");
             return {};
         }
 
-        auto j = json::parse(contents.value());
+        manifest::assets_t assets;
+        const auto parsed = manifest::read_assets({reinterpret_cast<const char*>(file.value().data), file.value().size}, assets_path, assets);
+        unmap_file(file.value());
+
+        if (!parsed)
+            return {};
+
+        // Packed archive is optional, loose files in the assets dir are used without it
+        if (auto archive = open_archive(GAME_ARCHIVE_PATH); archive)
+            ctx.archive = archive.value();
 
         unordered_map<string, string> shader_sources;
 
-        if (j.find("shaders") != j.end()) {
-            for (auto& sh : j["shaders"]) {
-                const auto name = sh.find("name") != sh.end() ? sh["name"].get<string>() : string{};
-                const auto source = sh.find("source") != sh.end() ? sh["source"].get<string>() : string{};
+        // Binary cache is useless when the driver exposes no binary formats
+        GLint binary_formats = 0;
+        glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &binary_formats);
+        const auto cache_dir = binary_formats > 0 ? get_cache_dir() : string{};
 
-                shader_sources.emplace(name, source);
+        for (const auto &sh : assets.shaders)
+            shader_sources.emplace(sh.name, sh.source);
+
+        for (const auto &p : assets.programs) {
+            const trace::scope_t scope{p.name};
+
+            if (!p.vertex.empty() && !p.fragment.empty()) {
+                const auto vs_source = shader_sources.find(p.vertex) != shader_sources.end() ? shader_sources[p.vertex] : string{};
+                const auto fs_source = shader_sources.find(p.fragment) != shader_sources.end() ? shader_sources[p.fragment] : string{};
+
+                if (const auto sh = compile(vs_source, fs_source, cache_dir); sh) {
+                    journal::debug("'%1' shader added", p.name);
+                    ctx.shaders.emplace(p.name, sh.value());
+                }
             }
         }
 
-        if (j.find("programs") != j.end()) {
-            for (auto& p : j["programs"]) {
-                const auto program_name = p.find("name") != p.end() ? p["name"].get<string>() : string{};
-                const auto vs_source_name = p.find("vertex") != p.end() ? p["vertex"].get<string>() : string{};
-                const auto fs_source_name = p.find("fragment") != p.end() ? p["fragment"].get<string>() : string{};
+        for (const auto &pp : assets.postprocess) {
+            postprocess_t pass;
+            pass.name = pp.name;
+            pass.program = pp.program;
+            pass.option = pp.option;
 
-                if (!vs_source_name.empty() && !fs_source_name.empty()) {
-                    const auto vs_source = shader_sources.find(vs_source_name) != shader_sources.end() ? shader_sources[vs_source_name] : string{};
-                    const auto fs_source = shader_sources.find(fs_source_name) != shader_sources.end() ? shader_sources[fs_source_name] : string{};
+            if (ctx.shaders.find(pass.program) == ctx.shaders.end()) {
+                journal::warning("Program '%1' for '%2' postprocess not found", pass.program, pass.name);
+                continue;
+            }
 
-                    if (const auto sh = compile(vs_source, fs_source); sh) {
-                        journal::debug("'%1' shader added", program_name);
-                        ctx.shaders.emplace(program_name, sh.value());
-                    }
-                }
+            journal::debug("'%1' postprocess added", pass.name);
+            ctx.postprocess.push_back(pass);
+        }
+
+        const auto s3tc_supported = has_extension("GL_EXT_texture_compression_s3tc");
+        if (!s3tc_supported)
+            journal::info("%1", "S3TC is not supported, using uncompressed textures");
+
+        ctx.textures.s3tc_supported = s3tc_supported;
+
+        // Every texture gets a handle, only preloaded ones are decoded now, others on first use
+        vector<decode_task_t> textures;
+        for (const auto &t : assets.textures) {
+            if (t.source.empty())
+                continue;
+
+            texture_entry_t entry;
+            entry.name = t.name;
+            entry.source = t.source;
+            entry.stream = t.stream;
+
+            if (t.preload) {
+                decode_task_t task;
+                task.name = entry.name;
+                task.source = entry.source;
+                task.stream = entry.stream;
+                textures.push_back(std::move(task));
             }
+
+            add_texture_entry(ctx.textures, std::move(entry));
         }
 
-        if (j.find("textures") != j.end()) {
-            for (auto& t : j["textures"]) {
-                const auto texture_name = t.find("name") != t.end() ? t["name"].get<string>() : string{};
-                const auto levels = t.find("levels") != t.end() ? t["levels"].get<vector<string>>() : vector<string>{};
+        for (const auto &m : assets.music)
+            ctx.music[m.name] = m.source;
 
-                if (!levels.empty()) {
-                    const auto path = GAME_ASSETS_DIR + string{"/"} + levels.front();
+        vector<decode_task_t> sounds;
+        for (const auto &s : assets.sounds) {
+            decode_task_t task;
+            task.name = s.name;
+            task.source = s.source;
+            task.priority = s.priority;
 
-                    auto rw = SDL_RWFromFile(path.c_str(), "r");
-                    if (!rw) {
-                        journal::error("%1", SDL_GetError());
-                        continue;
-                    }
+            if (s.instances != 0)
+                ctx.sound_events.instance_limits[s.name] = s.instances;
 
-                    const auto image = load_targa(rw);
+            if (!task.source.empty())
+                sounds.push_back(std::move(task));
+        }
 
-                    if (image) {
-                        const auto tex = create_texture(image.value(), false);
-                        if (tex) {
-                            journal::debug("'%1' texture added", texture_name);
-                            ctx.textures.emplace(texture_name, tex.value());
-                        }
+        // Decoding touches no GL state, so it runs on every core; uploads stay on this thread
+        const auto decode_start = SDL_GetPerformanceCounter();
 
-                    } else {
-                        journal::warning("Can't load '%1' image", texture_name);
-                    }
-                }
+        {
+            const trace::scope_t scope{"decode assets"};
+
+            workers::parallel_for(*ctx.workers, textures.size() + sounds.size(), [&] (const size_t i) {
+                if (i < textures.size())
+                    decode_texture(ctx.archive, s3tc_supported, textures[i]);
+                else
+                    decode_sound(ctx.archive, ctx.audio_format, sounds[i - textures.size()]);
+            });
+        }
+
+        const auto decode_end = SDL_GetPerformanceCounter();
+
+        // Reported in config order, whichever worker finished first
+        auto decode_ticks = 0ull;
+        for (const auto *tasks : {&textures, &sounds}) {
+            for (const auto &task : *tasks) {
+                decode_ticks += task.ticks;
+
+                if (!task.error.empty())
+                    journal::warning("Can't load '%1': %2", task.name, task.error);
+                else
+                    journal::debug("'%1' decoded in %2 ms", task.name, get_milliseconds(task.ticks));
             }
         }
 
-        if (j.find("sounds") != j.end()) {
-            for (auto& s : j["sounds"] ) {
-                const auto sound_name = s.find("name") != s.end() ? s["name"].get<string>() : string{};
-                const auto sound_source = s.find("source") != s.end() ? s["source"].get<string>() : string{};
-
-                if (!sound_source.empty()) {
-                    const auto path = GAME_ASSETS_DIR + string{"/"} + sound_source;
-
-                    auto rw = SDL_RWFromFile(path.c_str(), "r");
-                    if (!rw) {
-                        journal::error("%1", SDL_GetError());
-                        continue;
-                    }
-
-                    const auto wave = load_wave(rw);
-
-                    if (wave) {
-                        const auto snd = create_sound(wave.value());
-                        if (snd) {
-                            journal::debug("'%1' sound added", sound_name);
-                            ctx.sounds.emplace(sound_name, snd.value());
-                        }
-                    } else {
-                        journal::warning("Can't load '%1' sound", sound_name);
-                    }
+        journal::info("%1 assets decoded in %2 ms, %3 ms of work on %4 threads", textures.size() + sounds.size(),
+                      get_milliseconds(decode_end - decode_start), get_milliseconds(decode_ticks), ctx.workers->threads.size() + 1);
+
+        {
+            const trace::scope_t scope{"upload textures"};
+
+            for (auto &task : textures) {
+                if (!task.image) {
+                    find_texture_entry(ctx.textures, task.name)->failed = true;
+                    continue;
                 }
+
+                // Streamed textures are uploaded after the first frame within per-frame budget
+                if (task.stream)
+                    enqueue_upload(ctx.uploads, task.name, std::move(task.image.value()));
+                else
+                    stage_upload(ctx.uploads, task.name, task.image.value());
+
+                find_texture_entry(ctx.textures, task.name)->pending = true;
+            }
+
+            finish_uploads(ctx);
+        }
+
+        const trace::scope_t scope{"create sounds"};
+
+        for (auto &task : sounds) {
+            if (!task.wave)
+                continue;
+
+            auto snd = create_sound(task.wave.value());
+            if (snd) {
+                snd.value().priority = task.priority;
+
+                journal::debug("'%1' sound added", task.name);
+                ctx.sounds.emplace(task.name, snd.value());
             }
         }
 
         return true;
     }
 
+    auto rebuild_program(game::context_t &ctx, const std::string_view name, const std::string_view vert_source, const std::string_view frag_source) -> std::optional<shader_t> {
+        // Old program keeps running when the new sources don't build
+        const auto sh = compile(vert_source, frag_source);
+        if (!sh)
+            return {};
+
+        auto &current = ctx.shaders[std::string{name}];
+        if (current.id != 0)
+            glDeleteProgram(current.id);
+
+        current = sh.value();
+
+        return sh;
+    }
+
     auto get_shader(const game::context_t &ctx, const std::string_view name) -> std::optional<shader_t> {
         const auto it = ctx.shaders.find(name.data());
         if (it == ctx.shaders.end())
@@ -277,11 +526,58 @@ namespace resources {
     }
 
     auto get_texture(const game::context_t &ctx, const std::string_view name) -> std::optional<texture_t> {
-        const auto it = ctx.textures.find(name.data());
-        if (it == ctx.textures.end())
+        const auto it = ctx.textures.handles.find(name.data());
+        if (it == ctx.textures.handles.end())
             return {};
 
-        return it->second;
+        return ctx.textures.entries[it->second - 1].texture;
+    }
+
+    auto use_texture(game::context_t &ctx, const texture_t &texture) -> texture_t {
+        auto &cache = ctx.textures;
+        if (texture.handle == 0 || texture.handle > cache.entries.size())
+            return texture;
+
+        auto &entry = cache.entries[texture.handle - 1];
+        entry.last_used = cache.frame;
+
+        if (entry.texture.id != 0) {
+            cache.stats.hits++;
+            return entry.texture;
+        }
+
+        if (entry.pending || entry.failed)
+            return entry.texture;
+
+        cache.stats.misses++;
+
+        // Loaded on the spot, so the first frame using a texture already draws it
+        decode_task_t task;
+        task.name = entry.name;
+        task.source = entry.source;
+        decode_texture(ctx.archive, cache.s3tc_supported, task);
+
+        if (!task.image) {
+            journal::warning("Can't load '%1': %2", task.name, task.error);
+            entry.failed = true;
+            return entry.texture;
+        }
+
+        journal::debug("'%1' decoded on first use in %2 ms", task.name, get_milliseconds(task.ticks));
+
+        // Streamed textures show up once the upload queue gets to them
+        if (entry.stream) {
+            enqueue_upload(ctx.uploads, entry.name, std::move(task.image.value()));
+            entry.pending = true;
+            return entry.texture;
+        }
+
+        if (const auto tex = upload_texture(task.image.value()); tex)
+            make_resident(cache, texture.handle, tex.value(), get_image_size(task.image.value()));
+        else
+            entry.failed = true;
+
+        return cache.entries[texture.handle - 1].texture;
     }
 
     auto get_sound(const game::context_t &ctx, const std::string_view name) -> std::optional<sound_t> {
@@ -292,15 +588,29 @@ namespace resources {
         return it->second;
     }
 
+    auto open_music(const game::context_t &ctx, const std::string_view name) -> SDL_RWops* {
+        const auto it = ctx.music.find(std::string{name});
+        if (it == ctx.music.end()) {
+            journal::warning("Music '%1' not found", name);
+            return nullptr;
+        }
+
+        return open_asset(ctx.archive, it->second);
+    }
+
     auto cleanup(game::context_t &ctx) -> void {
+        cleanup_uploads(ctx.uploads);
+
         for (auto sh : ctx.shaders)
             glDeleteProgram(sh.second.id);
 
-        for (auto tex : ctx.textures)
-            glDeleteTextures(1, &tex.second.id);
+        report_texture_stats(ctx.textures);
+        cleanup_textures(ctx.textures);
 
         for (auto snd : ctx.sounds)
             destroy_sound(snd.second);
+
+        close_archive(ctx.archive);
     }
 
 } // namespace resources
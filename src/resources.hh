@@ -13,6 +13,8 @@ namespace game {
 
 } // namespace game
 
+typedef struct SDL_RWops SDL_RWops;
+
 namespace resources {
 
     typedef struct uniform_type {
@@ -48,6 +50,7 @@ namespace resources {
         uint32_t width = 0;
         uint32_t height = 0;
         uint32_t depth = 0;
+        uint32_t handle = 0;
     } texture_t;
 
     enum class pixel_format : uint32_t {
@@ -64,7 +67,9 @@ namespace resources {
         rgba16f,
         rgb32f,
         rgba32f,
-        depth
+        depth,
+        bc1,
+        bc3
     };
 
     typedef struct image_type {
@@ -73,18 +78,34 @@ namespace resources {
         uint32_t width = 0;
         uint32_t height = 0;
         uint32_t depth = 0;
+        uint32_t mip_levels = 1;
         pixel_format format = pixel_format::unknown;
         std::vector<uint8_t> pixels;
     } image_t;
 
+    typedef struct postprocess_type {
+        postprocess_type() = default;
+
+        std::string name;
+        std::string program;
+        std::string option;
+    } postprocess_t;
+
     struct sound_type;
     typedef sound_type sound_t;
 
     auto init(game::context_t &ctx, const std::string_view assets_path) -> bool;
     auto cleanup(game::context_t &ctx) -> void;
 
+    auto rebuild_program(game::context_t &ctx, const std::string_view name, const std::string_view vert_source, const std::string_view frag_source) -> std::optional<shader_t>;
+
     auto get_shader(const game::context_t &ctx, const std::string_view name) -> std::optional<shader_t>;
     auto get_texture(const game::context_t &ctx, const std::string_view name) -> std::optional<texture_t>;
+    auto use_texture(game::context_t &ctx, const texture_t &texture) -> texture_t;
     auto get_sound(const game::context_t &ctx, const std::string_view name) -> std::optional<sound_t>;
 
+    // Reader for a streamed track, null if it isn't listed or can't be opened.
+    // A packed track is read from the archive mapping, which has to stay open until the stream is closed.
+    auto open_music(const game::context_t &ctx, const std::string_view name) -> SDL_RWops*;
+
 } // namespace resources
@@ -1,27 +1,140 @@
 namespace audio {
     inline namespace sdl_mixer_backend {
 
-        auto init(game::context_t &ctx) -> std::optional<context_t>  {
-            (void)ctx;
+        // Runs on the SDL audio thread before the channels are mixed, always hooked so the callback can be timed
+        static auto music_callback(void *userdata, Uint8 *stream, int len) -> void {
+            auto &hooks = *static_cast<mix_hooks_t*>(userdata);
+            hooks.start = probe_now();
+
+            // Stream arrives silenced, with no track it stays that way
+            if (hooks.music) {
+                const auto frames = static_cast<size_t>(len) / (sizeof(int16_t) * MUSIC_CHANNELS);
+                read_music(*hooks.music, reinterpret_cast<int16_t*>(stream), frames);
+            }
+        }
+
+        // Runs on the SDL audio thread once the channels are mixed, so every sound started before it was in this block
+        static auto post_mix_callback(void *userdata, Uint8 *stream, int len) -> void {
+            (void)stream;
+
+            auto &hooks = *static_cast<mix_hooks_t*>(userdata);
+            const auto frames = static_cast<size_t>(len) / (sizeof(int16_t) * MUSIC_CHANNELS);
 
+            record_issued_latency(hooks.latency, probe_now());
+            end_callback(hooks.stats, hooks.start, frames, static_cast<uint32_t>(Mix_Playing(-1)));
+        }
+
+        auto init(game::context_t &ctx) -> std::optional<context_t>  {
             context_t a;
 
-            if (Mix_OpenAudio(44100, MIX_DEFAULT_FORMAT, MIX_DEFAULT_CHANNELS, 4096) == -1) {
+            if (Mix_OpenAudio(ctx.audio_format.frequency, MIX_DEFAULT_FORMAT, MIX_DEFAULT_CHANNELS, ctx.audio_format.buffer_frames) == -1) {
                 journal::critical("%1", SDL_GetError());
                 return {};
             }
 
+            // Rate and channels may differ from the request, chunks are converted to whatever was opened
+            auto frequency = 0;
+            auto format = uint16_t{0};
+            auto channels = 0;
+            if (Mix_QuerySpec(&frequency, &format, &channels) != 0) {
+                ctx.audio_format.frequency = frequency;
+                ctx.audio_format.channels = channels;
+            }
+
+            // Raw chunks are taken as they are, so anything but int16 would play noise
+            if (format != AUDIO_S16SYS) {
+                journal::critical("%1", "Audio device isn't 16 bit");
+                Mix_CloseAudio();
+                return {};
+            }
+
+            a.format = ctx.audio_format;
+            a.hooks = std::make_unique<mix_hooks_t>();
+            a.hooks->stats.frequency = frequency;
+
+            Mix_HookMusic(music_callback, a.hooks.get());
+            Mix_SetPostMix(post_mix_callback, a.hooks.get());
+
+            journal::debug("Audio device opened, %1 Hz, %2 frames per callback", frequency, a.format.buffer_frames);
+
             return a;
         }
 
         auto cleanup(context_t &ctx) -> void {
+            stop_music(ctx);
+
+            Mix_HookMusic(nullptr, nullptr);
+            Mix_SetPostMix(nullptr, nullptr);
             Mix_CloseAudio();
+
+            if (ctx.hooks) {
+                report_callback_stats(ctx.hooks->stats);
+                report_latency(ctx.hooks->latency, ctx.format.buffer_frames, ctx.format.frequency);
+            }
         }
 
-        auto play_sound(context_t &ctx, const resources::sound_t &sound, const bool looped) -> void {
-            if (Mix_PlayChannel(-1, sound.chunk, 0) == -1) {
+        auto play_sound(context_t &ctx, const resources::sound_t &sound, const bool looped, const float gain) -> void {
+            // Held across start and stamp, so the callback sees both or neither
+            SDL_LockAudio();
+
+            const auto issued = probe_now();
+            const auto channel = Mix_PlayChannel(-1, sound.chunk, looped ? -1 : 0);
+            if (channel != -1) {
+                Mix_Volume(channel, std::clamp(static_cast<int>(gain * MIX_MAX_VOLUME), 0, MIX_MAX_VOLUME));
+
+                if (ctx.hooks)
+                    push(ctx.hooks->latency.issued, issued);
+            }
+
+            SDL_UnlockAudio();
+
+            if (channel == -1)
                 journal::critical("%1", SDL_GetError());
+        }
+
+        // Returns with the audio thread out of the callback, so the old stream can go
+        static auto set_music(context_t &ctx, music_stream_t *music) -> void {
+            SDL_LockAudio();
+            ctx.hooks->music = music;
+            SDL_UnlockAudio();
+        }
+
+        auto play_music(context_t &ctx, SDL_RWops *rw, const bool looped) -> bool {
+            stop_music(ctx);
+
+            if (!rw)
+                return false;
+
+            // Stream is decoded straight into the device format
+            if (ctx.format.channels != MUSIC_CHANNELS) {
+                journal::error("Music needs a stereo device, got %1 channels", ctx.format.channels);
+                SDL_RWclose(rw);
+                return false;
             }
+
+            ctx.music = open_music(rw, looped, ctx.format.frequency);
+            if (!ctx.music)
+                return false;
+
+            set_music(ctx, ctx.music.get());
+
+            return true;
+        }
+
+        auto stop_music(context_t &ctx) -> void {
+            if (!ctx.music)
+                return;
+
+            set_music(ctx, nullptr);
+            close_music(ctx.music);
+        }
+
+        auto update(context_t &ctx) -> void {
+            if (ctx.music)
+                report_music_underruns(*ctx.music);
+
+            if (ctx.hooks)
+                collect_latency(ctx.hooks->latency);
         }
 
     } // namespace sdl_mixer_backend
@@ -30,6 +143,19 @@ namespace audio {
 
 namespace resources {
 
+    auto get_sound_duration(const sound_t &snd) -> float {
+        auto frequency = 0;
+        auto format = uint16_t{0};
+        auto channels = 0;
+        if (!snd.chunk || Mix_QuerySpec(&frequency, &format, &channels) == 0)
+            return 0.0f;
+
+        // Chunks are converted to the device format when loaded
+        const auto bytes_per_frame = static_cast<uint32_t>(channels) * SDL_AUDIO_BITSIZE(format) / 8;
+
+        return static_cast<float>(snd.chunk->alen / bytes_per_frame) / static_cast<float>(frequency);
+    }
+
     auto create_sound(const wave_t &wave) -> std::optional<sound_t> {
         sound_t snd;
         snd.chunk = wave;
@@ -0,0 +1,183 @@
+namespace audio {
+
+    inline namespace mixer_backend {
+
+        // Runs on the SDL audio thread, so it only touches the mixer
+        static auto audio_callback(void *userdata, Uint8 *stream, int len) -> void {
+            auto &mixer = *static_cast<mixer_t*>(userdata);
+            const auto frames = static_cast<size_t>(len) / (sizeof(int16_t) * MIXER_CHANNELS);
+            const auto start = probe_now();
+
+            mix(mixer, reinterpret_cast<int16_t*>(stream), frames);
+
+            end_callback(mixer.stats, start, frames, mixer.active_voices.load(std::memory_order_relaxed));
+        }
+
+        auto init_null_device() -> std::optional<context_t> {
+            context_t a;
+            a.mixer = create_mixer();
+            a.null_device = true;
+            a.format.frequency = MIXER_FREQUENCY;
+            a.format.channels = MIXER_CHANNELS;
+
+            journal::debug("%1", "Audio mixed into null device");
+
+            return a;
+        }
+
+        auto init(game::context_t &ctx) -> std::optional<context_t> {
+            if (ctx.headless) {
+                auto a = init_null_device();
+                ctx.audio_format = a.value().format;
+                return a;
+            }
+
+            context_t a;
+            a.mixer = create_mixer();
+
+            SDL_AudioSpec desired = {};
+            desired.freq = ctx.audio_format.frequency;
+            desired.format = AUDIO_S16SYS;
+            desired.channels = MIXER_CHANNELS;
+            desired.samples = static_cast<uint16_t>(ctx.audio_format.buffer_frames);
+            desired.callback = audio_callback;
+            desired.userdata = a.mixer.get();
+
+            // Rate and buffer may change to what the hardware does best, the mixer doesn't care about the rate
+            SDL_AudioSpec obtained = {};
+            a.device = SDL_OpenAudioDevice(nullptr, 0, &desired, &obtained, SDL_AUDIO_ALLOW_FREQUENCY_CHANGE | SDL_AUDIO_ALLOW_SAMPLES_CHANGE);
+            if (a.device == 0) {
+                journal::critical("Can't open audio device: %1", SDL_GetError());
+                return {};
+            }
+
+            a.format.frequency = obtained.freq;
+            a.format.channels = MIXER_CHANNELS;
+            a.format.buffer_frames = obtained.samples;
+            ctx.audio_format = a.format;
+            a.mixer->stats.frequency = obtained.freq;
+
+            journal::debug("Audio device opened, %1 Hz, %2 frames per callback", obtained.freq, obtained.samples);
+
+            SDL_PauseAudioDevice(a.device, 0);
+
+            return a;
+        }
+
+        auto cleanup(context_t &ctx) -> void {
+            stop_music(ctx);
+
+            if (ctx.device != 0)
+                SDL_CloseAudioDevice(ctx.device);
+
+            ctx.device = 0;
+
+            if (!ctx.mixer)
+                return;
+
+            if (ctx.mixer->dropped_voices.load() + ctx.mixer->dropped_commands > 0)
+                journal::warning("Mixer dropped %1 sounds for lack of voices and %2 commands for a full queue",
+                                 ctx.mixer->dropped_voices.load(), ctx.mixer->dropped_commands);
+
+            if (!ctx.null_device) {
+                report_callback_stats(ctx.mixer->stats);
+                report_latency(ctx.mixer->latency, ctx.format.buffer_frames, ctx.format.frequency);
+            }
+        }
+
+        auto play_sound(context_t &ctx, const resources::sound_t &sound, const bool looped, const float gain) -> void {
+            submit_play(*ctx.mixer, sound.samples, sound.frames, gain, looped);
+        }
+
+        auto stop_sound(context_t &ctx, const resources::sound_t &sound) -> void {
+            submit_stop(*ctx.mixer, sound.samples);
+        }
+
+        auto change_volume(context_t &ctx, int volume) -> void {
+            ctx.volume = std::clamp(volume, 0, MAX_AUDIO_VOLUME);
+            submit_volume(*ctx.mixer, static_cast<float>(ctx.volume) / MAX_AUDIO_VOLUME);
+        }
+
+        // The callback only reads the pointer, holding the device keeps it from running meanwhile
+        static auto set_music(context_t &ctx, music_stream_t *music) -> void {
+            if (ctx.device != 0)
+                SDL_LockAudioDevice(ctx.device);
+
+            ctx.mixer->music = music;
+
+            if (ctx.device != 0)
+                SDL_UnlockAudioDevice(ctx.device);
+        }
+
+        auto play_music(context_t &ctx, SDL_RWops *rw, const bool looped) -> bool {
+            stop_music(ctx);
+
+            ctx.music = open_music(rw, looped, ctx.format.frequency);
+            if (!ctx.music)
+                return false;
+
+            set_music(ctx, ctx.music.get());
+
+            return true;
+        }
+
+        auto stop_music(context_t &ctx) -> void {
+            if (!ctx.music)
+                return;
+
+            set_music(ctx, nullptr);
+            close_music(ctx.music);
+        }
+
+        auto update(context_t &ctx) -> void {
+            if (ctx.music)
+                report_music_underruns(*ctx.music);
+
+            collect_latency(ctx.mixer->latency);
+        }
+
+        auto render(context_t &ctx, const size_t frames) -> void {
+            if (!ctx.null_device)
+                return;
+
+            // Mixes faster than real time, the decoder is waited for instead of heard as an underrun
+            if (ctx.music)
+                wait_music(*ctx.music, frames);
+
+            ctx.output.resize(frames * MIXER_CHANNELS);
+            mix(*ctx.mixer, ctx.output.data(), frames);
+        }
+
+    } // namespace mixer_backend
+
+} // namespace audio
+
+namespace resources {
+
+    auto get_sound_duration(const sound_t &snd) -> float {
+        return snd.frequency > 0 ? static_cast<float>(snd.frames) / static_cast<float>(snd.frequency) : 0.0f;
+    }
+
+    auto create_sound(const wave_t &wave) -> std::optional<sound_t> {
+        if (wave.samples.empty())
+            return {};
+
+        // Owned by the sound until destroy_sound, voices point straight into it
+        auto samples = new int16_t[wave.samples.size()];
+        std::copy(wave.samples.begin(), wave.samples.end(), samples);
+
+        sound_t snd;
+        snd.samples = samples;
+        snd.frames = static_cast<uint32_t>(wave.samples.size() / audio::MIXER_CHANNELS);
+        snd.frequency = wave.frequency;
+
+        return snd;
+    }
+
+    auto destroy_sound(sound_t &snd) -> void {
+        delete[] snd.samples;
+        snd.samples = nullptr;
+        snd.frames = 0;
+    }
+
+} // namespace resources
@@ -0,0 +1,84 @@
+#include <algorithm>
+#include <cmath>
+
+#include "journal.hh"
+#include "game.hh"
+#include "sound_events.hh"
+
+namespace audio {
+
+    auto queue_sound(sound_events_t &events, const std::string_view name, const float gain) -> void {
+        events.queued++;
+
+        auto it = std::find_if(events.pending.begin(), events.pending.end(), [&name] (const auto &ev) {
+            return ev.name == name;
+        });
+
+        if (it != events.pending.end()) {
+            it->count++;
+            it->gain = std::max(it->gain, gain);
+            events.merged++;
+            return;
+        }
+
+        sound_event_t ev;
+        ev.name = name;
+        ev.tick = events.tick;
+        ev.count = 1;
+        ev.gain = gain;
+
+        events.pending.push_back(std::move(ev));
+    }
+
+    auto flush_sounds(game::context_t &ctx, context_t &atx) -> size_t {
+        auto &events = ctx.sound_events;
+        const auto now = static_cast<double>(events.tick) * game::timestep;
+
+        auto played = size_t{0};
+        for (const auto &ev : events.pending) {
+            const auto snd = resources::get_sound(ctx, ev.name);
+            if (!snd)
+                continue;
+
+            auto &playing = events.playing[ev.name];
+            playing.erase(std::remove_if(playing.begin(), playing.end(), [now] (const auto end) {
+                return end <= now;
+            }), playing.end());
+
+            const auto limit = events.instance_limits.count(ev.name) ? events.instance_limits[ev.name] : DEFAULT_SOUND_INSTANCES;
+            if (playing.size() >= limit) {
+                events.limited += ev.count;
+                continue;
+            }
+
+            // Copies hit at the same instant add up in phase, so one louder voice replaces them, up to what every backend can play
+            const auto gain = std::min(ev.gain * std::sqrt(static_cast<float>(ev.count)), std::max(ev.gain, MAX_COALESCED_GAIN));
+
+            play_sound(atx, snd.value(), false, gain);
+            playing.push_back(now + static_cast<double>(resources::get_sound_duration(snd.value())));
+            played++;
+        }
+
+        events.played += played;
+        events.pending.clear();
+
+        return played;
+    }
+
+    auto get_sounds_end(const sound_events_t &events) -> double {
+        auto end = 0.0;
+        for (const auto &sound : events.playing)
+            for (const auto instance : sound.second)
+                end = std::max(end, instance);
+
+        return end;
+    }
+
+    auto report_sound_events(const sound_events_t &events) -> void {
+        if (events.queued == 0)
+            return;
+
+        journal::info("Sound requests %1, played %2, merged %3, over instance limit %4", events.queued, events.played, events.merged, events.limited);
+    }
+
+} // namespace audio
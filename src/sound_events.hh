@@ -0,0 +1,62 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <unordered_map>
+
+#include "audio.hh"
+
+namespace game {
+
+    struct context_type;
+    typedef context_type context_t;
+
+} // namespace game
+
+namespace audio {
+
+    constexpr uint32_t DEFAULT_SOUND_INSTANCES = 4;
+    // SDL_mixer and OpenAL clamp anything louder, so merged requests never go past it on any backend
+    constexpr float MAX_COALESCED_GAIN = 1.0f;
+
+    // Every request for one sound within a frame, merged into a single play
+    typedef struct sound_event_type {
+        sound_event_type() = default;
+
+        std::string name;
+        uint64_t tick = 0; // simulation tick of the first request
+        uint32_t count = 0;
+        float gain = 0.0f;
+    } sound_event_t;
+
+    typedef struct sound_events_type {
+        sound_events_type() = default;
+
+        std::vector<sound_event_t> pending;
+        uint64_t tick = 0; // advanced by game::update
+
+        // Instances still audible per sound, as end times in simulation seconds
+        std::unordered_map<std::string, std::vector<double>> playing;
+        std::unordered_map<std::string, uint32_t> instance_limits;
+
+        uint64_t queued = 0;
+        uint64_t played = 0;
+        uint64_t merged = 0;
+        uint64_t limited = 0;
+    } sound_events_t;
+
+    // Gameplay side, nothing reaches the backend until the flush
+    auto queue_sound(sound_events_t &events, const std::string_view name, const float gain = 1.0f) -> void;
+
+    // Once per frame: one backend call per distinct sound, skipped over the instance limit.
+    // Merged requests are raised towards MAX_COALESCED_GAIN, so only ones queued below it get louder.
+    auto flush_sounds(game::context_t &ctx, context_t &atx) -> size_t;
+
+    // Simulation time in seconds the last flushed sound stops playing
+    auto get_sounds_end(const sound_events_t &events) -> double;
+
+    auto report_sound_events(const sound_events_t &events) -> void;
+
+} // namespace audio
@@ -0,0 +1,83 @@
+#pragma once
+
+#include <cstddef>
+#include <atomic>
+#include <array>
+
+// Bounded single producer, single consumer ring, both sides are wait-free and never allocate
+
+template<typename T, size_t N>
+struct spsc_queue_type {
+    static_assert(N > 0 && (N & (N - 1)) == 0, "capacity must be a power of two");
+
+    std::array<T, N> items = {};
+
+    // Kept on separate cache lines, so producer and consumer don't contend
+    alignas(64) std::atomic<size_t> head{0}; // next item to pop, written by the consumer
+    alignas(64) std::atomic<size_t> tail{0}; // next free slot, written by the producer
+};
+
+template<typename T, size_t N>
+using spsc_queue_t = spsc_queue_type<T, N>;
+
+// Producer side, false when full
+template<typename T, size_t N>
+inline auto push(spsc_queue_t<T, N> &q, const T &item) -> bool {
+    const auto tail = q.tail.load(std::memory_order_relaxed);
+    if (tail - q.head.load(std::memory_order_acquire) == N)
+        return false;
+
+    q.items[tail & (N - 1)] = item;
+    q.tail.store(tail + 1, std::memory_order_release);
+
+    return true;
+}
+
+// Consumer side, false when empty
+template<typename T, size_t N>
+inline auto pop(spsc_queue_t<T, N> &q, T &item) -> bool {
+    const auto head = q.head.load(std::memory_order_relaxed);
+    if (head == q.tail.load(std::memory_order_acquire))
+        return false;
+
+    item = q.items[head & (N - 1)];
+    q.head.store(head + 1, std::memory_order_release);
+
+    return true;
+}
+
+// Producer side, copies as many items as fit and returns how many
+template<typename T, size_t N>
+inline auto push_n(spsc_queue_t<T, N> &q, const T *items, const size_t count) -> size_t {
+    const auto tail = q.tail.load(std::memory_order_relaxed);
+    const auto space = N - (tail - q.head.load(std::memory_order_acquire));
+    const auto n = count < space ? count : space;
+
+    for (size_t i = 0; i < n; i++)
+        q.items[(tail + i) & (N - 1)] = items[i];
+
+    q.tail.store(tail + n, std::memory_order_release);
+
+    return n;
+}
+
+// Consumer side, copies as many items as are ready and returns how many
+template<typename T, size_t N>
+inline auto pop_n(spsc_queue_t<T, N> &q, T *items, const size_t count) -> size_t {
+    const auto head = q.head.load(std::memory_order_relaxed);
+    const auto ready = q.tail.load(std::memory_order_acquire) - head;
+    const auto n = count < ready ? count : ready;
+
+    for (size_t i = 0; i < n; i++)
+        items[i] = q.items[(head + i) & (N - 1)];
+
+    q.head.store(head + n, std::memory_order_release);
+
+    return n;
+}
+
+// Either side, a snapshot that is only exact for the caller's own end
+template<typename T, size_t N>
+inline auto queued(const spsc_queue_t<T, N> &q) -> size_t {
+    return q.tail.load(std::memory_order_acquire) - q.head.load(std::memory_order_acquire);
+}
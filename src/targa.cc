@@ -1,4 +1,7 @@
+#include <cstring>
+#include <algorithm>
 #include <optional>
+#include <vector>
 #include <SDL2/SDL_rwops.h>
 
 #include "resources.hh"
@@ -33,73 +36,139 @@ typedef struct TargaHeader
 } TARGA_HEADER;
 #pragma pack(pop, tga_header_align)
 
-auto load_targa(SDL_RWops *rw) -> std::optional<resources::image_t> {
-    if (!rw)
-        return {};
-
-    resources::image_t image;
-
-    Sint64 lenght = SDL_RWsize(rw);
-
-    TARGA_HEADER header;
-    SDL_RWread(rw, &header, sizeof(header), 1);
-
-    const uint8_t bytesperpixel = header.bpp / 8;
-    std::vector<uint8_t> data;
-    data.resize(header.width * header.height * (bytesperpixel + 1));
-
-    uint8_t *pdata = &data[0];
+// Copies count pixels, swapping blue and red when asked
+static inline auto copy_pixels(uint8_t *dst, const uint8_t *src, const size_t count, const size_t bytesperpixel, const bool swizzle) -> void {
+    if (!swizzle || bytesperpixel < 3) {
+        memcpy(dst, src, count * bytesperpixel);
+        return;
+    }
 
-    if (header.data_type == TARGA_DATA_RLE_TRUE_COLOR) {
-        uint8_t block = 0;
-        size_t readen = 0;
+    if (bytesperpixel == 4) {
+        for (size_t i = 0; i < count; i++, dst += 4, src += 4) {
+            dst[0] = src[2];
+            dst[1] = src[1];
+            dst[2] = src[0];
+            dst[3] = src[3];
+        }
+    } else {
+        for (size_t i = 0; i < count; i++, dst += 3, src += 3) {
+            dst[0] = src[2];
+            dst[1] = src[1];
+            dst[2] = src[0];
+        }
+    }
+}
 
-        for (int i = 0; i < header.width * header.height; i++) {
-            readen = SDL_RWread(rw, &block, 1, 1);
+// Writes the first pixel, then doubles the filled part, so long runs become a few wide copies
+static inline auto fill_run(uint8_t *dst, const uint8_t *pixel, const size_t count, const size_t bytesperpixel, const bool swizzle) -> void {
+    copy_pixels(dst, pixel, 1, bytesperpixel, swizzle);
 
-            if (readen) {
-                uint8_t count = (block & 0x7f) + 1;
+    const auto total = count * bytesperpixel;
+    auto filled = bytesperpixel;
+    while (filled < total) {
+        const auto chunk = std::min(filled, total - filled);
+        memcpy(dst + filled, dst, chunk);
+        filled += chunk;
+    }
+}
 
-                if (block & 0x80) {
-                    uint8_t bytes[4] = {0};
-                    SDL_RWread(rw, bytes, bytesperpixel, 1);
+auto decode_targa(const uint8_t *data, const size_t size, const bool swizzle) -> std::optional<resources::image_t> {
+    if (!data || size < sizeof(TARGA_HEADER))
+        return {};
 
-                    for(int j = 0; j < count; j++) {
-                        memcpy(pdata, bytes, bytesperpixel);
-                        pdata += bytesperpixel;
-                    }
-                } else {
-                    SDL_RWread(rw, pdata, bytesperpixel * count, 1);
-                    pdata += bytesperpixel * count;
-                }
-            }
-        }
+    TARGA_HEADER header;
+    memcpy(&header, data, sizeof header);
 
-        SDL_RWclose(rw);
-    }
-    else if ((header.data_type == TARGA_DATA_TRUE_COLOR) || (header.data_type == TARGA_DATA_BLACK_AND_WHITE)) {
-        if (!SDL_RWread(rw, &data[0], lenght - sizeof(header), 1))
-            SDL_RWclose(rw);
-    }
+    resources::image_t image;
 
     switch (header.bpp) {
     case 8:
         image.format = resources::pixel_format::r8;
         break;
     case 24:
-        image.format = resources::pixel_format::bgr8;
+        image.format = swizzle ? resources::pixel_format::rgb8 : resources::pixel_format::bgr8;
         break;
     case 32:
-        image.format = resources::pixel_format::bgra8;
+        image.format = swizzle ? resources::pixel_format::rgba8 : resources::pixel_format::bgra8;
         break;
     default:
-        image.format = resources::pixel_format::unknown;
+        return {};
+    }
+
+    const size_t bytesperpixel = header.bpp / 8u;
+    const size_t pixel_count = static_cast<size_t>(header.width) * header.height;
+    const size_t colormap_size = header.color_map ? header.colormap_length * ((header.colormap_entry_size + 7u) / 8u) : 0;
+
+    // Image id and color map sit between the header and pixels
+    auto src = data + sizeof header + header.length + colormap_size;
+    const auto end = data + size;
+    if (src > end)
+        return {};
+
+    // Every byte is written below, resize is the only allocation
+    image.pixels.resize(pixel_count * bytesperpixel);
+    auto dst = image.pixels.data();
+
+    if (header.data_type == TARGA_DATA_RLE_TRUE_COLOR || header.data_type == TARGA_DATA_RLE_BLACK_AND_WITE) {
+        size_t decoded = 0;
+
+        while (decoded < pixel_count) {
+            if (src >= end)
+                return {};
+
+            const auto block = *src++;
+            const size_t count = std::min<size_t>((block & 0x7fu) + 1u, pixel_count - decoded);
+
+            if (block & 0x80) {
+                if (static_cast<size_t>(end - src) < bytesperpixel)
+                    return {};
+
+                fill_run(dst, src, count, bytesperpixel, swizzle);
+                src += bytesperpixel;
+            } else {
+                if (static_cast<size_t>(end - src) < count * bytesperpixel)
+                    return {};
+
+                copy_pixels(dst, src, count, bytesperpixel, swizzle);
+                src += count * bytesperpixel;
+            }
+
+            dst += count * bytesperpixel;
+            decoded += count;
+        }
+    } else if (header.data_type == TARGA_DATA_TRUE_COLOR || header.data_type == TARGA_DATA_BLACK_AND_WHITE) {
+        if (static_cast<size_t>(end - src) < image.pixels.size())
+            return {};
+
+        copy_pixels(dst, src, pixel_count, bytesperpixel, swizzle);
+    } else {
+        return {};
     }
 
     image.width = header.width;
     image.height = header.height;
     image.depth = 0;
-    image.pixels = data;
 
     return image;
 }
+
+auto load_targa(SDL_RWops *rw) -> std::optional<resources::image_t> {
+    if (!rw)
+        return {};
+
+    // One bulk read, then decode from memory
+    const auto lenght = SDL_RWsize(rw);
+    if (lenght <= 0) {
+        SDL_RWclose(rw);
+        return {};
+    }
+
+    std::vector<uint8_t> data(static_cast<size_t>(lenght));
+    const auto readen = SDL_RWread(rw, &data[0], data.size(), 1);
+    SDL_RWclose(rw);
+
+    if (readen != 1)
+        return {};
+
+    return decode_targa(data.data(), data.size(), false);
+}
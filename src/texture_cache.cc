@@ -0,0 +1,117 @@
+#include <algorithm>
+
+#include <GL/glcore.h>
+
+#include "journal.hh"
+#include "texture_cache.hh"
+
+namespace resources {
+
+    auto add_texture_entry(texture_cache_t &cache, texture_entry_t &&entry) -> uint32_t {
+        const auto handle = static_cast<uint32_t>(cache.entries.size() + 1);
+
+        entry.texture.handle = handle;
+        cache.handles[entry.name] = handle;
+        cache.entries.push_back(std::move(entry));
+
+        return handle;
+    }
+
+    auto find_texture_entry(texture_cache_t &cache, const std::string_view name) -> texture_entry_t* {
+        const auto it = cache.handles.find(std::string{name});
+        if (it == cache.handles.end())
+            return nullptr;
+
+        return &cache.entries[it->second - 1];
+    }
+
+    auto make_resident(texture_cache_t &cache, const uint32_t handle, const texture_t &texture, const size_t size) -> void {
+        auto &entry = cache.entries[handle - 1];
+
+        entry.texture.id = texture.id;
+        entry.texture.target = texture.target;
+        entry.texture.width = texture.width;
+        entry.texture.height = texture.height;
+        entry.texture.depth = texture.depth;
+        entry.size = size;
+        entry.last_used = cache.frame;
+        entry.pending = false;
+
+        cache.resident_bytes += size;
+        cache.stats.uploads++;
+        cache.stats.uploaded_bytes += size;
+        cache.stats.peak_bytes = std::max(cache.stats.peak_bytes, cache.resident_bytes);
+
+        journal::debug("'%1' texture resident, %2 KiB in use", entry.name, cache.resident_bytes / 1024);
+
+        evict_textures(cache);
+    }
+
+    static auto evict(texture_cache_t &cache, texture_entry_t &entry) -> void {
+        glDeleteTextures(1, &entry.texture.id);
+
+        cache.resident_bytes -= entry.size;
+        cache.stats.evictions++;
+
+        journal::debug("'%1' texture evicted", entry.name);
+
+        entry.texture.id = 0;
+        entry.size = 0;
+    }
+
+    auto evict_textures(texture_cache_t &cache) -> void {
+        if (cache.budget == 0)
+            return;
+
+        while (cache.resident_bytes > cache.budget) {
+            // Textures drawn this frame stay, the budget is exceeded rather than the frame broken
+            texture_entry_t *oldest = nullptr;
+            for (auto &entry : cache.entries) {
+                if (entry.texture.id == 0 || entry.last_used >= cache.frame)
+                    continue;
+
+                if (!oldest || entry.last_used < oldest->last_used)
+                    oldest = &entry;
+            }
+
+            if (!oldest)
+                break;
+
+            evict(cache, *oldest);
+        }
+    }
+
+    auto invalidate_texture(texture_cache_t &cache, const uint32_t handle) -> void {
+        auto &entry = cache.entries[handle - 1];
+
+        if (entry.texture.id != 0) {
+            glDeleteTextures(1, &entry.texture.id);
+            cache.resident_bytes -= entry.size;
+        }
+
+        entry.texture.id = 0;
+        entry.size = 0;
+        entry.failed = false;
+    }
+
+    auto report_texture_stats(const texture_cache_t &cache) -> void {
+        const auto &s = cache.stats;
+        const auto lookups = s.hits + s.misses;
+
+        journal::info("Textures: %1 hits, %2 misses (%3%), %4 uploads (%5 KiB), %6 evictions, peak %7 KiB of %8 KiB budget",
+                      s.hits, s.misses, lookups ? s.misses * 100 / lookups : 0, s.uploads, s.uploaded_bytes / 1024,
+                      s.evictions, s.peak_bytes / 1024, cache.budget / 1024);
+    }
+
+    auto cleanup_textures(texture_cache_t &cache) -> void {
+        for (auto &entry : cache.entries) {
+            if (entry.texture.id != 0)
+                glDeleteTextures(1, &entry.texture.id);
+        }
+
+        cache.entries.clear();
+        cache.handles.clear();
+        cache.resident_bytes = 0;
+    }
+
+} // namespace resources
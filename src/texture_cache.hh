@@ -0,0 +1,66 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <unordered_map>
+
+#include "resources.hh"
+
+namespace resources {
+
+    typedef struct texture_entry_type {
+        texture_entry_type() = default;
+
+        std::string name;
+        std::string source;
+        bool stream = false;
+
+        // Id is zero while the texture is not resident
+        texture_t texture;
+        size_t size = 0;
+        uint64_t last_used = 0;
+        bool pending = false;
+        bool failed = false;
+    } texture_entry_t;
+
+    typedef struct texture_stats_type {
+        texture_stats_type() = default;
+
+        size_t hits = 0;
+        size_t misses = 0;
+        size_t uploads = 0;
+        size_t uploaded_bytes = 0;
+        size_t evictions = 0;
+        size_t peak_bytes = 0;
+    } texture_stats_t;
+
+    typedef struct texture_cache_type {
+        texture_cache_type() = default;
+
+        // Handle is the entry index plus one, zero means no texture
+        std::vector<texture_entry_t> entries;
+        std::unordered_map<std::string, uint32_t> handles;
+
+        size_t budget = 0;
+        size_t resident_bytes = 0;
+        uint64_t frame = 0;
+        bool s3tc_supported = false;
+
+        texture_stats_t stats;
+    } texture_cache_t;
+
+    auto add_texture_entry(texture_cache_t &cache, texture_entry_t &&entry) -> uint32_t;
+    auto find_texture_entry(texture_cache_t &cache, const std::string_view name) -> texture_entry_t*;
+
+    // Least recently used textures are evicted until the cache fits into budget again
+    auto make_resident(texture_cache_t &cache, const uint32_t handle, const texture_t &texture, const size_t size) -> void;
+    auto evict_textures(texture_cache_t &cache) -> void;
+
+    // Drops the GL texture but keeps the handle, the next use loads the source again
+    auto invalidate_texture(texture_cache_t &cache, const uint32_t handle) -> void;
+
+    auto report_texture_stats(const texture_cache_t &cache) -> void;
+    auto cleanup_textures(texture_cache_t &cache) -> void;
+
+} // namespace resources
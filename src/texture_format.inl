@@ -46,9 +46,75 @@ namespace resources {
             format = GL_DEPTH_COMPONENT;
             type = GL_UNSIGNED_SHORT;
             break;
+        case pixel_format::bc1:
+            internalformat = GL_COMPRESSED_RGB_S3TC_DXT1_EXT;
+            format = GL_RGB;
+            type = GL_UNSIGNED_BYTE;
+            break;
+        case pixel_format::bc3:
+            internalformat = GL_COMPRESSED_RGBA_S3TC_DXT5_EXT;
+            format = GL_RGBA;
+            type = GL_UNSIGNED_BYTE;
+            break;
+        default:
+            break;
+        }
+    }
+
+    inline auto get_pixel_size(pixel_format pf) -> size_t {
+        switch (pf) {
+        case pixel_format::r8:
+            return 1;
+        case pixel_format::rg8:
+            return 2;
+        case pixel_format::rgb8:
+        case pixel_format::bgr8:
+            return 3;
+        case pixel_format::rgba8:
+        case pixel_format::bgra8:
+        case pixel_format::r32f:
+            return 4;
+        case pixel_format::r16f:
+        case pixel_format::depth:
+            return 2;
+        case pixel_format::rgb16f:
+            return 6;
+        case pixel_format::rgba16f:
+            return 8;
+        case pixel_format::rgb32f:
+            return 12;
+        case pixel_format::rgba32f:
+            return 16;
         default:
             break;
         }
+
+        return 0;
+    }
+
+    inline auto get_block_size(pixel_format pf) -> size_t {
+        switch (pf) {
+        case pixel_format::bc1:
+            return 8;
+        case pixel_format::bc3:
+            return 16;
+        default:
+            break;
+        }
+
+        return 0;
+    }
+
+    inline auto is_compressed(pixel_format pf) -> bool {
+        return get_block_size(pf) != 0;
+    }
+
+    // Size of one level of a block compressed image, blocks are 4x4 pixels
+    inline auto get_compressed_size(pixel_format pf, const uint32_t width, const uint32_t height) -> size_t {
+        const auto blocks_x = std::max(1u, (width + 3) / 4);
+        const auto blocks_y = std::max(1u, (height + 3) / 4);
+
+        return static_cast<size_t>(blocks_x) * blocks_y * get_block_size(pf);
     }
 
 } // namespace resources
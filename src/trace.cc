@@ -0,0 +1,136 @@
+#include <cstdio>
+#include <chrono>
+#include <mutex>
+#include <string>
+#include <vector>
+#include <fstream>
+
+#include "journal.hh"
+#include "trace.hh"
+
+namespace trace {
+
+    std::atomic<bool> enabled{false};
+
+    typedef struct event_type {
+        event_type() = default;
+
+        std::string name;
+        uint64_t start_ns = 0;
+        uint64_t end_ns = 0;
+        uint32_t thread = 0;
+    } event_t;
+
+    static std::mutex lock;
+    static std::vector<event_t> events;
+    static std::vector<std::pair<uint32_t, std::string>> thread_names;
+    static std::string output_path;
+    static uint64_t origin_ns = 0;
+
+    // Small sequential ids read better in the viewer than native thread handles
+    static auto get_thread_id() -> uint32_t {
+        static std::atomic<uint32_t> next_id{1};
+        thread_local const auto id = next_id.fetch_add(1, std::memory_order_relaxed);
+
+        return id;
+    }
+
+    auto now_ns() -> uint64_t {
+        using namespace std::chrono;
+
+        return static_cast<uint64_t>(duration_cast<nanoseconds>(steady_clock::now().time_since_epoch()).count());
+    }
+
+    auto start(const std::string_view path) -> void {
+        std::lock_guard<std::mutex> guard{lock};
+
+        output_path = path;
+        origin_ns = now_ns();
+        events.reserve(256);
+        enabled.store(true, std::memory_order_relaxed);
+    }
+
+    auto record(const std::string_view name, const uint64_t start_ns, const uint64_t end_ns) -> void {
+        event_t ev;
+        ev.name = name;
+        ev.start_ns = start_ns;
+        ev.end_ns = end_ns;
+        ev.thread = get_thread_id();
+
+        std::lock_guard<std::mutex> guard{lock};
+        if (enabled.load(std::memory_order_relaxed))
+            events.push_back(std::move(ev));
+    }
+
+    auto name_thread(const std::string_view name) -> void {
+        if (!is_enabled())
+            return;
+
+        const auto id = get_thread_id();
+
+        std::lock_guard<std::mutex> guard{lock};
+        thread_names.emplace_back(id, std::string{name});
+    }
+
+    static auto write_string(std::ofstream &fs, const std::string_view str) -> void {
+        fs << '"';
+        for (const auto c : str) {
+            if (c == '"' || c == '\\')
+                fs << '\\' << c;
+            else if (static_cast<unsigned char>(c) >= 0x20)
+                fs << c;
+        }
+        fs << '"';
+    }
+
+    // Trace timestamps are microseconds, the fraction keeps nanosecond precision
+    static auto write_microseconds(std::ofstream &fs, const uint64_t ns) -> void {
+        char buf[32] = {};
+        snprintf(buf, sizeof buf, "%llu.%03llu", static_cast<unsigned long long>(ns / 1000), static_cast<unsigned long long>(ns % 1000));
+        fs << buf;
+    }
+
+    auto finish() -> bool {
+        std::lock_guard<std::mutex> guard{lock};
+
+        if (!enabled.exchange(false))
+            return false;
+
+        std::ofstream fs{output_path, std::ios::out | std::ios::trunc};
+        if (!fs.is_open()) {
+            journal::error("Can't write trace '%1'", output_path);
+            return false;
+        }
+
+        fs << "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n";
+
+        auto first = true;
+        for (const auto &[id, name] : thread_names) {
+            fs << (first ? "" : ",\n") << "{\"ph\":\"M\",\"name\":\"thread_name\",\"pid\":1,\"tid\":" << id << ",\"args\":{\"name\":";
+            write_string(fs, name);
+            fs << "}}";
+            first = false;
+        }
+
+        for (const auto &ev : events) {
+            fs << (first ? "" : ",\n") << "{\"ph\":\"X\",\"cat\":\"startup\",\"pid\":1,\"tid\":" << ev.thread << ",\"name\":";
+            write_string(fs, ev.name);
+            fs << ",\"ts\":";
+            write_microseconds(fs, ev.start_ns - origin_ns);
+            fs << ",\"dur\":";
+            write_microseconds(fs, ev.end_ns - ev.start_ns);
+            fs << "}";
+            first = false;
+        }
+
+        fs << "\n]}\n";
+
+        journal::info("Trace with %1 events written to '%2'", events.size(), output_path);
+
+        events.clear();
+        thread_names.clear();
+
+        return true;
+    }
+
+} // namespace trace
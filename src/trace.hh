@@ -0,0 +1,47 @@
+#pragma once
+
+#include <cstdint>
+#include <atomic>
+#include <string_view>
+
+// Scoped startup timing, written as a Chrome/Perfetto trace (chrome://tracing, ui.perfetto.dev)
+
+namespace trace {
+
+    extern std::atomic<bool> enabled;
+
+    inline auto is_enabled() -> bool {
+        return enabled.load(std::memory_order_relaxed);
+    }
+
+    auto now_ns() -> uint64_t;
+
+    // Events are kept in memory until finish writes them to the path
+    auto start(const std::string_view path) -> void;
+    auto finish() -> bool;
+
+    auto record(const std::string_view name, const uint64_t start_ns, const uint64_t end_ns) -> void;
+    auto name_thread(const std::string_view name) -> void;
+
+    // Name has to outlive the scope; nothing is read or stored when tracing is off
+    typedef struct scope_type {
+        explicit scope_type(const std::string_view event_name) {
+            if (is_enabled()) {
+                name = event_name;
+                start = now_ns();
+            }
+        }
+
+        ~scope_type() {
+            if (start != 0)
+                record(name, start, now_ns());
+        }
+
+        scope_type(const scope_type&) = delete;
+        scope_type& operator=(const scope_type&) = delete;
+
+        std::string_view name;
+        uint64_t start = 0;
+    } scope_t;
+
+} // namespace trace
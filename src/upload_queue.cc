@@ -0,0 +1,222 @@
+#include <cstring>
+#include <algorithm>
+
+#include <GL/glcore.h>
+#include <GL/ext_texture_compression_s3tc.h>
+
+#include "journal.hh"
+#include "game.hh"
+#include "upload_queue.hh"
+#include "texture_cache.hh"
+
+#include "texture_format.inl"
+
+namespace resources {
+
+    auto get_image_size(const image_t &image) -> size_t {
+        if (is_compressed(image.format))
+            return image.pixels.size();
+
+        const auto size = static_cast<size_t>(image.width) * image.height * get_pixel_size(image.format);
+        return std::min(size, image.pixels.size());
+    }
+
+    // Pixels are an offset into the bound PBO or client memory when none is bound
+    static auto define_texture(const image_t &image, const uint8_t *pixels, const size_t size, const bool mipmaps) -> uint32_t {
+        auto internal_format = static_cast<GLint >(0);
+        auto format = static_cast<GLenum>(0);
+        auto type = static_cast<GLenum>(0);
+        get_texture_format_from_pixelformat(image.format, internal_format, format, type);
+
+        auto id = 0u;
+        glGenTextures(1, &id);
+        glBindTexture(GL_TEXTURE_2D, id);
+
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+
+        if (is_compressed(image.format)) {
+            auto offset = size_t{0};
+            auto w = image.width;
+            auto h = image.height;
+            auto level = 0u;
+
+            for (; level < image.mip_levels && offset < size; level++) {
+                const auto level_size = get_compressed_size(image.format, w, h);
+                if (offset + level_size > size)
+                    break;
+
+                glCompressedTexImage2D(GL_TEXTURE_2D, static_cast<GLint>(level), static_cast<GLenum>(internal_format), static_cast<GLsizei>(w), static_cast<GLsizei>(h), 0,
+                                       static_cast<GLsizei>(level_size), pixels + offset);
+
+                offset += level_size;
+                w = std::max(1u, w / 2);
+                h = std::max(1u, h / 2);
+            }
+
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, static_cast<GLint>(std::max(1u, level) - 1));
+        } else {
+            glTexImage2D(GL_TEXTURE_2D, 0, internal_format, static_cast<GLsizei>(image.width), static_cast<GLsizei>(image.height), 0, format, type, pixels);
+
+            if (mipmaps)
+                glGenerateMipmap(GL_TEXTURE_2D);
+        }
+
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+        glBindTexture(GL_TEXTURE_2D, 0);
+
+        return id;
+    }
+
+    static auto acquire_pbo(upload_queue_t &queue) -> uint32_t {
+        if (!queue.free_pbos.empty()) {
+            const auto pbo = queue.free_pbos.back();
+            queue.free_pbos.pop_back();
+            return pbo;
+        }
+
+        auto pbo = 0u;
+        glGenBuffers(1, &pbo);
+        return pbo;
+    }
+
+    auto stage_upload(upload_queue_t &queue, const std::string_view name, const image_t &image, const bool mipmaps) -> void {
+        const auto size = get_image_size(image);
+        if (size == 0) {
+            journal::warning("Empty '%1' image", name);
+            return;
+        }
+
+        upload_t upload;
+        upload.name = name;
+        upload.pbo = acquire_pbo(queue);
+
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, upload.pbo);
+
+        // Orphan previous storage so mapping never waits for the last transfer from this PBO
+        glBufferData(GL_PIXEL_UNPACK_BUFFER, static_cast<GLsizeiptr>(size), nullptr, GL_STREAM_DRAW);
+
+        auto dst = glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, static_cast<GLsizeiptr>(size), GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+        if (!dst) {
+            journal::error("Can't map pixel buffer for '%1'", name);
+            glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+            queue.free_pbos.push_back(upload.pbo);
+            return;
+        }
+
+        memcpy(dst, &image.pixels[0], size);
+        glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+
+        // Source is the bound PBO, so this returns before the pixels are transferred
+        const auto id = define_texture(image, nullptr, size, mipmaps);
+
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+
+        upload.texture = texture_t{id, GL_TEXTURE_2D, image.width, image.height, 0};
+        upload.size = size;
+        upload.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+
+        queue.uploaded_bytes += size;
+        queue.in_flight.push_back(upload);
+    }
+
+    auto upload_texture(const image_t &image, const bool mipmaps) -> std::optional<texture_t> {
+        const auto size = get_image_size(image);
+        if (size == 0)
+            return {};
+
+        const auto id = define_texture(image, &image.pixels[0], size, mipmaps);
+
+        return texture_t{id, GL_TEXTURE_2D, image.width, image.height, 0};
+    }
+
+    auto enqueue_upload(upload_queue_t &queue, const std::string_view name, image_t &&image, const bool mipmaps) -> void {
+        upload_request_t request;
+        request.name = name;
+        request.image = std::move(image);
+        request.mipmaps = mipmaps;
+
+        queue.requests.push_back(std::move(request));
+    }
+
+    static auto publish(game::context_t &ctx, upload_t &upload) -> void {
+        glDeleteSync(reinterpret_cast<GLsync>(upload.fence));
+        upload.fence = nullptr;
+
+        ctx.uploads.free_pbos.push_back(upload.pbo);
+        ctx.uploads.uploaded_textures++;
+
+        // Entry could have been loaded synchronously in the meantime
+        const auto entry = find_texture_entry(ctx.textures, upload.name);
+        if (entry && entry->texture.id == 0)
+            make_resident(ctx.textures, entry->texture.handle, upload.texture, upload.size);
+        else
+            glDeleteTextures(1, &upload.texture.id);
+    }
+
+    static auto publish_completed(game::context_t &ctx, const uint64_t timeout) -> size_t {
+        auto &in_flight = ctx.uploads.in_flight;
+
+        auto published = 0u;
+        for (auto &upload : in_flight) {
+            const auto status = glClientWaitSync(reinterpret_cast<GLsync>(upload.fence), timeout ? GL_SYNC_FLUSH_COMMANDS_BIT : 0, timeout);
+            if (status == GL_ALREADY_SIGNALED || status == GL_CONDITION_SATISFIED) {
+                publish(ctx, upload);
+                published++;
+            }
+        }
+
+        in_flight.erase(std::remove_if(in_flight.begin(), in_flight.end(), [] (const auto &upload) {
+            return upload.fence == nullptr;
+        }), in_flight.end());
+
+        return published;
+    }
+
+    auto process_uploads(game::context_t &ctx, const size_t budget) -> size_t {
+        auto &queue = ctx.uploads;
+
+        // Called once per frame, so it also ticks the clock textures are aged by
+        ctx.textures.frame++;
+
+        const auto published = publish_completed(ctx, 0);
+
+        // At least one request goes through each frame, so oversized images still make progress
+        auto spent = size_t{0};
+        while (!queue.requests.empty() && (spent == 0 || spent + get_image_size(queue.requests.front().image) <= budget)) {
+            auto &request = queue.requests.front();
+            spent += get_image_size(request.image);
+
+            stage_upload(queue, request.name, request.image, request.mipmaps);
+            queue.requests.pop_front();
+        }
+
+        return published;
+    }
+
+    auto finish_uploads(game::context_t &ctx) -> void {
+        constexpr uint64_t timeout = 1000000000ull; // 1 sec
+
+        while (!ctx.uploads.in_flight.empty()) {
+            if (publish_completed(ctx, timeout) == 0) {
+                journal::warning("%1", "Texture uploads take too long");
+                break;
+            }
+        }
+    }
+
+    auto cleanup_uploads(upload_queue_t &queue) -> void {
+        for (auto &upload : queue.in_flight) {
+            glDeleteSync(reinterpret_cast<GLsync>(upload.fence));
+            glDeleteTextures(1, &upload.texture.id);
+            glDeleteBuffers(1, &upload.pbo);
+        }
+
+        if (!queue.free_pbos.empty())
+            glDeleteBuffers(static_cast<GLsizei>(queue.free_pbos.size()), &queue.free_pbos[0]);
+
+        queue.in_flight.clear();
+        queue.free_pbos.clear();
+        queue.requests.clear();
+    }
+
+} // namespace resources
@@ -0,0 +1,64 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <deque>
+#include <optional>
+#include <vector>
+
+#include "resources.hh"
+
+namespace game {
+
+    struct context_type;
+    typedef context_type context_t;
+
+} // namespace game
+
+namespace resources {
+
+    typedef struct upload_request_type {
+        upload_request_type() = default;
+
+        std::string name;
+        image_t image;
+        bool mipmaps = false;
+    } upload_request_t;
+
+    typedef struct upload_type {
+        upload_type() = default;
+
+        std::string name;
+        texture_t texture;
+        size_t size = 0;
+        uint32_t pbo = 0;
+        void *fence = nullptr;
+    } upload_t;
+
+    typedef struct upload_queue_type {
+        upload_queue_type() = default;
+
+        std::deque<upload_request_t> requests;
+        std::vector<upload_t> in_flight;
+        std::vector<uint32_t> free_pbos;
+
+        size_t uploaded_textures = 0;
+        size_t uploaded_bytes = 0;
+    } upload_queue_t;
+
+    auto get_image_size(const image_t &image) -> size_t;
+
+    // Copies pixels into a PBO and starts the transfer, the texture is published once the GPU is done with it
+    auto stage_upload(upload_queue_t &queue, const std::string_view name, const image_t &image, const bool mipmaps = false) -> void;
+
+    // Blocking upload straight from client memory, for textures needed in the current frame
+    auto upload_texture(const image_t &image, const bool mipmaps = false) -> std::optional<texture_t>;
+
+    // Defers staging until process_uploads has budget left in some frame
+    auto enqueue_upload(upload_queue_t &queue, const std::string_view name, image_t &&image, const bool mipmaps = false) -> void;
+
+    auto process_uploads(game::context_t &ctx, const size_t budget) -> size_t;
+    auto finish_uploads(game::context_t &ctx) -> void;
+    auto cleanup_uploads(upload_queue_t &queue) -> void;
+
+} // namespace resources
@@ -1,6 +1,10 @@
 #pragma once
 
 #include <fstream>
+#include <optional>
+#include <string>
+#include <string_view>
+
 inline auto get_config(std::string_view path) -> std::optional<std::string> {
     using namespace std;
 
@@ -19,13 +23,37 @@ inline auto get_config(std::string_view path) -> std::optional<std::string> {
     return contents;
 }
 
+#include <cstdint>
+inline auto hash_fnv1a(const void *data, const size_t size, const uint64_t seed = 0xcbf29ce484222325ull) -> uint64_t {
+    auto hash = seed;
+    const auto bytes = static_cast<const uint8_t*>(data);
+    for (size_t i = 0; i < size; i++) {
+        hash ^= bytes[i];
+        hash *= 0x100000001b3ull;
+    }
+
+    return hash;
+}
+
+inline auto hash_fnv1a(const std::string_view str, const uint64_t seed = 0xcbf29ce484222325ull) -> uint64_t {
+    return hash_fnv1a(str.data(), str.size(), seed);
+}
+
 #include <random>
+inline auto get_random_engine() -> std::mt19937& {
+    static std::mt19937 rng{std::random_device()()};
+    return rng;
+}
+
+// Fixed seed makes scripted sessions reproducible
+inline auto seed_random(const uint32_t seed) -> void {
+    get_random_engine().seed(seed);
+}
+
 inline auto random(const int start, const int end) -> int {
-    std::mt19937 rng;
-    rng.seed(std::random_device()());
-    std::uniform_int_distribution<std::mt19937::result_type> dist(start, end);
+    std::uniform_int_distribution<int> dist(start, end);
 
-    return dist(rng);
+    return dist(get_random_engine());
 }
 
 #include <glm/glm.hpp>
@@ -13,6 +13,51 @@
 
 namespace video {
 
+    static auto get_option(const std::string_view name) -> uint32_t {
+        if (name == "shake")
+            return OP_SHAKE;
+        if (name == "confuse")
+            return OP_CONFUSE;
+        if (name == "chaos")
+            return OP_CHAOS;
+
+        return 0;
+    }
+
+    static auto upload_postprocess_constants(const resources::shader_t &sh) -> void {
+        const float blur_kernel[9] = {
+            1.0 / 16, 2.0 / 16, 1.0 / 16,
+            2.0 / 16, 4.0 / 16, 2.0 / 16,
+            1.0 / 16, 2.0 / 16, 1.0 / 16
+        };
+
+        const float edge_kernel[9] = {
+            -1, -1, -1,
+            -1,  8, -1,
+            -1, -1, -1
+        };
+
+        const float offset = 1.0f / 300.0f;
+        const std::vector<vec2> offsets = {vec2{ -offset,  offset  },  // top-left
+                                           vec2{  0.0f,    offset  },  // top-center
+                                           vec2{  offset,  offset  },  // top-right
+                                           vec2{ -offset,  0.0f    },  // center-left
+                                           vec2{  0.0f,    0.0f    },  // center-center
+                                           vec2{  offset,  0.0f    },  // center - right
+                                           vec2{ -offset, -offset  },  // bottom-left
+                                           vec2{  0.0f,   -offset  },  // bottom-center
+                                           vec2{  offset, -offset  }}; // bottom-right
+
+        glUseProgram(sh.id);
+
+        set_value(sh, "scene", 0);
+        set_value(sh, "offsets", offsets);
+        set_value(sh, "blur_kernel", blur_kernel);
+        set_value(sh, "edge_kernel", edge_kernel);
+
+        glUseProgram(0);
+    }
+
     auto init(game::context_t &ctx) -> std::optional<context_t> {
         context_t r;
         r.sprites.reserve(1000);
@@ -31,11 +76,24 @@ namespace video {
             return {};
         }
 
-        if (auto sh = resources::get_shader(ctx, "postprocess"); sh) {
-            r.postprocess_shader = sh.value();
-        } else {
-            journal::error("%1", "'postprocess' shader not found");
-            return {};
+        for (const auto &pp : ctx.postprocess) {
+            postprocess_pass_t pass;
+            pass.option = get_option(pp.option);
+
+            if (pass.option == 0) {
+                journal::warning("Unknown option '%1' for '%2' postprocess", pp.option, pp.name);
+                continue;
+            }
+
+            if (auto sh = resources::get_shader(ctx, pp.program); sh) {
+                pass.shader = sh.value();
+            } else {
+                journal::error("'%1' shader not found", pp.program);
+                return {};
+            }
+
+            upload_postprocess_constants(pass.shader);
+            r.postprocess.push_back(pass);
         }
 
         {
@@ -113,9 +171,11 @@ namespace video {
             glBindVertexArray(0);
         }
 
-        glGenTextures(1, &r.color_tex);
-        glBindTexture(GL_TEXTURE_2D, r.color_tex);
-        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB8, ctx.width, ctx.height, 0, GL_RGB, GL_UNSIGNED_BYTE, nullptr);
+        glGenTextures(static_cast<GLsizei>(r.target_tex.size()), &r.target_tex[0]);
+        for (const auto tex : r.target_tex) {
+            glBindTexture(GL_TEXTURE_2D, tex);
+            glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, ctx.width, ctx.height, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+        }
         glBindTexture(GL_TEXTURE_2D, 0);
 
         glGenSamplers(1, &r.texture_sampler);
@@ -125,24 +185,41 @@ namespace video {
         glSamplerParameteri(r.texture_sampler, GL_TEXTURE_WRAP_S, GL_REPEAT);
         glSamplerParameteri(r.texture_sampler, GL_TEXTURE_WRAP_T, GL_REPEAT);
 
-        glGenFramebuffers(1, &r.color_fb);
+        glGenFramebuffers(static_cast<GLsizei>(r.target_fb.size()), &r.target_fb[0]);
         glGenFramebuffers(1, &r.sampled_fb);
         glGenRenderbuffers(1, &r.sampled_rb);
 
         glBindFramebuffer(GL_FRAMEBUFFER, r.sampled_fb);
         glBindRenderbuffer(GL_RENDERBUFFER, r.sampled_rb);
-        glRenderbufferStorageMultisample(GL_RENDERBUFFER, 16, GL_RGB, ctx.width, ctx.height);
+        glRenderbufferStorageMultisample(GL_RENDERBUFFER, 16, GL_RGBA8, ctx.width, ctx.height);
         glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, r.sampled_rb);
         if (auto status = glCheckFramebufferStatus(GL_FRAMEBUFFER); status != GL_FRAMEBUFFER_COMPLETE) {
             journal::error("Incomplite framebuffer %1", status);
             return {};
         }
 
-        glBindFramebuffer(GL_FRAMEBUFFER, r.color_fb);
-        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, r.color_tex, 0);
-        if (auto status = glCheckFramebufferStatus(GL_FRAMEBUFFER); status != GL_FRAMEBUFFER_COMPLETE) {
-            journal::error("Incomplite framebuffer %1", status);
-            return {};
+        for (size_t i = 0; i < r.target_fb.size(); i++) {
+            glBindFramebuffer(GL_FRAMEBUFFER, r.target_fb[i]);
+            glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, r.target_tex[i], 0);
+            if (auto status = glCheckFramebufferStatus(GL_FRAMEBUFFER); status != GL_FRAMEBUFFER_COMPLETE) {
+                journal::error("Incomplite framebuffer %1", status);
+                return {};
+            }
+        }
+
+        // Without a window the screen is an offscreen target, frames are read back from it
+        if (ctx.headless) {
+            glGenFramebuffers(1, &r.screen_fb);
+            glGenRenderbuffers(1, &r.screen_rb);
+
+            glBindFramebuffer(GL_FRAMEBUFFER, r.screen_fb);
+            glBindRenderbuffer(GL_RENDERBUFFER, r.screen_rb);
+            glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, ctx.width, ctx.height);
+            glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, r.screen_rb);
+            if (auto status = glCheckFramebufferStatus(GL_FRAMEBUFFER); status != GL_FRAMEBUFFER_COMPLETE) {
+                journal::error("Incomplite framebuffer %1", status);
+                return {};
+            }
         }
 
         glBindFramebuffer(GL_FRAMEBUFFER, 0);
@@ -195,6 +272,58 @@ namespace video {
         glBindVertexArray(0);
     }
 
+    static auto present_postprocess(const int w, const int h, const float ticks, context_t &ctx) {
+        const auto enabled = std::count_if(ctx.postprocess.begin(), ctx.postprocess.end(), [&ctx] (const auto &pass) {
+            return (ctx.options & pass.option) != 0;
+        });
+
+        // Resolve multisampled scene, formats must match so it can't go to the window directly
+        glBindFramebuffer(GL_READ_FRAMEBUFFER, ctx.sampled_fb);
+        glBindFramebuffer(GL_DRAW_FRAMEBUFFER, ctx.target_fb[0]);
+        glBlitFramebuffer(0, 0, w, h, 0, 0, w, h, GL_COLOR_BUFFER_BIT, GL_NEAREST);
+
+        // Nothing to apply, a single-sampled blit converts to whatever format the screen has
+        if (enabled == 0) {
+            glBindFramebuffer(GL_READ_FRAMEBUFFER, ctx.target_fb[0]);
+            glBindFramebuffer(GL_DRAW_FRAMEBUFFER, ctx.screen_fb);
+            glBlitFramebuffer(0, 0, w, h, 0, 0, w, h, GL_COLOR_BUFFER_BIT, GL_NEAREST);
+            glBindFramebuffer(GL_FRAMEBUFFER, 0);
+            return;
+        }
+
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+        glDisable(GL_BLEND);
+
+        glActiveTexture(GL_TEXTURE0);
+        glBindSampler(0, ctx.texture_sampler);
+        glBindVertexArray(ctx.screenquad_va);
+
+        auto source = 0u;
+        auto remaining = enabled;
+        for (const auto &pass : ctx.postprocess) {
+            if ((ctx.options & pass.option) == 0)
+                continue;
+
+            remaining--;
+
+            // Last enabled pass writes to the screen, others ping-pong between targets
+            glBindFramebuffer(GL_FRAMEBUFFER, remaining == 0 ? ctx.screen_fb : ctx.target_fb[source ^ 1]);
+
+            glUseProgram(pass.shader.id);
+            set_value(pass.shader, "time", ticks);
+
+            glBindTexture(GL_TEXTURE_2D, ctx.target_tex[source]);
+            glDrawArrays(GL_TRIANGLES, 0, 6);
+
+            source ^= 1;
+        }
+
+        glBindVertexArray(0);
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+        glEnable(GL_BLEND);
+    }
+
     auto present(const int w, const int h, const float ticks, context_t &ctx, const mat4 &proj, const mat4 &view) -> void {
         (void)view;
 
@@ -223,45 +352,7 @@ namespace video {
         for (const auto& p : ctx.particles)
             present_particles(ctx, p);
 
-        glBindFramebuffer(GL_READ_FRAMEBUFFER, ctx.sampled_fb);
-        glBindFramebuffer(GL_DRAW_FRAMEBUFFER, ctx.color_fb);
-        glBlitFramebuffer(0, 0, w, h, 0, 0, w, h, GL_COLOR_BUFFER_BIT, GL_NEAREST);
-        glBindFramebuffer(GL_FRAMEBUFFER, 0);
-
-        const float blur_kernel[9] = {
-            1.0 / 16, 2.0 / 16, 1.0 / 16,
-            2.0 / 16, 4.0 / 16, 2.0 / 16,
-            1.0 / 16, 2.0 / 16, 1.0 / 16
-        };
-
-        const float offset = 1.0f / 300.0f;
-        const std::vector<vec2> offsets = {vec2{ -offset,  offset  },  // top-left
-                                           vec2{  0.0f,    offset  },  // top-center
-                                           vec2{  offset,  offset  },  // top-right
-                                           vec2{ -offset,  0.0f    },  // center-left
-                                           vec2{  0.0f,    0.0f    },  // center-center
-                                           vec2{  offset,  0.0f    },  // center - right
-                                           vec2{ -offset, -offset  },  // bottom-left
-                                           vec2{  0.0f,   -offset  },  // bottom-center
-                                           vec2{  offset, -offset  }}; // bottom-right
-
-        glUseProgram(ctx.postprocess_shader.id);
-
-        set_value(ctx.postprocess_shader, "scene", 0);
-        set_value(ctx.postprocess_shader, "time", ticks);
-        set_value(ctx.postprocess_shader, "confuse", 0);
-        set_value(ctx.postprocess_shader, "chaos", 0);
-        set_value(ctx.postprocess_shader, "shake", static_cast<int32_t>(ctx.options & OP_SHAKE));
-        set_value(ctx.postprocess_shader, "offsets", offsets);
-        set_value(ctx.postprocess_shader, "blur_kernel", blur_kernel);
-
-        glActiveTexture(GL_TEXTURE0);
-        glBindTexture(GL_TEXTURE_2D, ctx.color_tex);
-        glBindSampler(0, ctx.texture_sampler);
-
-        glBindVertexArray(ctx.screenquad_va);
-        glDrawArrays(GL_TRIANGLES, 0, 6);
-        glBindVertexArray(0);
+        present_postprocess(w, h, ticks, ctx);
 
         glUseProgram(0);
 
@@ -276,9 +367,28 @@ namespace video {
 
         glDeleteSamplers(1, &ctx.texture_sampler);
 
+        glDeleteRenderbuffers(1, &ctx.screen_rb);
+        glDeleteFramebuffers(1, &ctx.screen_fb);
         glDeleteRenderbuffers(1, &ctx.sampled_rb);
         glDeleteFramebuffers(1, &ctx.sampled_fb);
-        glDeleteFramebuffers(1, &ctx.color_fb);
+        glDeleteFramebuffers(static_cast<GLsizei>(ctx.target_fb.size()), &ctx.target_fb[0]);
+        glDeleteTextures(static_cast<GLsizei>(ctx.target_tex.size()), &ctx.target_tex[0]);
+    }
+
+    auto replace_shader(context_t &ctx, const uint32_t old_id, const resources::shader_t &sh) -> void {
+        if (ctx.sprite_shader.id == old_id)
+            ctx.sprite_shader = sh;
+
+        if (ctx.particle_shader.id == old_id)
+            ctx.particle_shader = sh;
+
+        for (auto &pass : ctx.postprocess) {
+            if (pass.shader.id != old_id)
+                continue;
+
+            pass.shader = sh;
+            upload_postprocess_constants(pass.shader);
+        }
     }
 
     auto draw_sprite(context_t &ctx, const resources::texture_t &texture, const vec2 &position, const vec2 &size, const float rotate, const vec3 &color) -> void {
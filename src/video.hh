@@ -2,6 +2,7 @@
 
 #include <optional>
 #include <vector>
+#include <array>
 
 #include <glm/glm.hpp>
 
@@ -28,9 +29,18 @@ namespace video {
     using glm::mat4;
 
     enum OPTIONS : uint32_t {
-        OP_SHAKE = 1 << 0
+        OP_SHAKE = 1 << 0,
+        OP_CONFUSE = 1 << 1,
+        OP_CHAOS = 1 << 2
     };
 
+    typedef struct postprocess_pass_type {
+        postprocess_pass_type() = default;
+
+        resources::shader_t shader;
+        uint32_t option = 0;
+    } postprocess_pass_t;
+
     typedef struct context_type {
         context_type() = default;
 
@@ -38,15 +48,17 @@ namespace video {
         std::vector<game::particle_emitter> particles;
         resources::shader_t sprite_shader;
         resources::shader_t particle_shader;
-        resources::shader_t postprocess_shader;
+        std::vector<postprocess_pass_t> postprocess;
         uint32_t particle_va = 0;
         uint32_t sprite_va = 0;
         uint32_t screenquad_va = 0;
         uint32_t texture_sampler = 0;
+        uint32_t screen_fb = 0;
+        uint32_t screen_rb = 0;
         uint32_t sampled_fb = 0;
         uint32_t sampled_rb = 0;
-        uint32_t color_fb = 0;
-        uint32_t color_tex = 0;
+        std::array<uint32_t, 2> target_fb = {};
+        std::array<uint32_t, 2> target_tex = {};
         uint32_t options = 0;
     } context_t;
 
@@ -54,6 +66,9 @@ namespace video {
     auto present(const int w, const int h, const float ticks, context_t &ctx, const mat4 &proj, const mat4 &view) -> void;
     auto cleanup(context_t &ctx) -> void;
 
+    // Swaps every copy of a rebuilt program, so the running session picks it up
+    auto replace_shader(context_t &ctx, const uint32_t old_id, const resources::shader_t &sh) -> void;
+
     auto draw_sprite(context_t &ctx, const resources::texture_t &texture, const vec2 &position, const vec2 &size = vec2{10, 10}, const float rotate = 0.0f, const glm::vec3 &color = vec3{1.0f}) -> void;
     auto draw_particles(context_t &ctx, const game::particle_emitter &emitter) -> void;
 } // namespace video
@@ -1,96 +1,161 @@
 #include <optional>
-#include <SDL2/SDL_rwops.h>
-
+#include <algorithm>
+#include <cstring>
 #include "resources.hh"
 #include "audio.hh"
+#include "pcm_convert.hh"
+#include "pcm_format.hh"
+
+// Every backend gets int16 in the device format, the conversion happens here once
 
 #ifdef OPENAL_BACKEND
 
-#pragma pack(push, wave_align)
-#pragma pack(1)
-struct riff_header {
-    uint8_t  chunkID[4];
-    uint32_t chunkSize;   // size not including chunkSize or chunkID
-    uint8_t  format[4];
-};
-
-struct wave_format {
-    uint8_t  subChunkID[4];
-    uint32_t subChunkSize;
-    uint16_t audioFormat;
-    uint16_t numChannels;
-    uint32_t sampleRate;
-    uint32_t byteRate;
-    uint16_t blockAlign;
-    uint16_t bitsPerSample;
-};
-
-struct wave_data {
-    char     subChunkID[4]; // should contain the word data
-    uint32_t subChunk2Size; // Stores the size of the data block
-};
-#pragma pack(pop, wave_align)
-
-auto load_wave(SDL_RWops *rw) -> std::optional<resources::wave_t> {
-    if (!rw)
+static auto make_wave(std::vector<int16_t> samples, const int frequency, const int channels) -> std::optional<resources::wave_t> {
+    if (samples.empty())
         return {};
 
-    riff_header riff;
-    SDL_RWread(rw, &riff, sizeof riff, 1);
+    resources::wave_t wave;
+    wave.frequency = frequency;
+    wave.format = channels == 1 ? resources::audio_format::mono16 : resources::audio_format::stereo16;
+    wave.size = static_cast<uint32_t>(samples.size() * sizeof(int16_t));
+    wave.bytes.resize(wave.size);
+    memcpy(wave.bytes.data(), samples.data(), wave.size);
 
-    if (memcmp(riff.chunkID, "RIFF", sizeof riff.chunkID) != 0 && memcmp(riff.format, "WAVE", sizeof riff.format) != 0)
+    return wave;
+}
+
+// Int16 at the device rate needs nothing done, OpenAL takes mono and stereo as they are
+static auto make_wave_view(const uint8_t *data, const size_t size, const int frequency, const int channels, const audio::device_format_t &format) -> std::optional<resources::wave_t> {
+    if (size == 0 || size > UINT32_MAX || frequency != format.frequency || (channels != 1 && channels != 2))
         return {};
 
-    wave_format format;
-    SDL_RWread(rw, &format, sizeof format, 1);
+    resources::wave_t wave;
+    wave.frequency = frequency;
+    wave.format = channels == 1 ? resources::audio_format::mono16 : resources::audio_format::stereo16;
+    wave.size = static_cast<uint32_t>(size);
+    wave.view = data;
+
+    return wave;
+}
+
+// A view into the file becomes an offset into it once the wave owns it
+static auto keep_file(std::optional<resources::wave_t> &wave, std::vector<uint8_t> file) -> void {
+    if (!wave || !wave.value().view)
+        return;
+
+    wave.value().offset = static_cast<size_t>(wave.value().view - file.data());
+    wave.value().view = nullptr;
+    wave.value().bytes = std::move(file);
+}
+
+#elif SOFTWARE_MIXER_BACKEND
 
-    if (memcmp(format.subChunkID, "fmt ", sizeof riff.chunkID) != 0)
+static auto make_wave(std::vector<int16_t> samples, const int frequency, const int channels) -> std::optional<resources::wave_t> {
+    if (samples.empty() || channels != audio::MIXER_CHANNELS)
         return {};
 
     resources::wave_t wave;
-    while (true) {
-        wave_data data;
-        if (SDL_RWread(rw, &data, sizeof data, 1) == 0)
-            break;
-
-        if (memcmp(data.subChunkID, "data", sizeof format.subChunkID) == 0) {
-            std::vector<uint8_t> bytes;
-            bytes.resize(data.subChunk2Size);
-            SDL_RWread(rw, &bytes[0], data.subChunk2Size, 1);
-
-            wave.size = static_cast<uint32_t>(data.subChunk2Size);
-            wave.frequency = format.sampleRate;
-
-            if (format.numChannels == 1) {
-                if (format.bitsPerSample == 8)
-                    wave.format = resources::audio_format::mono8;
-                else if (format.bitsPerSample == 16)
-                    wave.format = resources::audio_format::mono16;
-            } else {
-                if (format.bitsPerSample == 8)
-                    wave.format = resources::audio_format::stereo8;
-                else if(format.bitsPerSample == 16)
-                    wave.format = resources::audio_format::stereo16;
-            }
-
-            break;
-        }
-
-        SDL_RWseek(rw, data.subChunk2Size, RW_SEEK_CUR);
-    }
+    wave.samples = std::move(samples);
+    wave.frequency = frequency;
 
     return wave;
 }
 
+static auto keep_file(std::optional<resources::wave_t> &, std::vector<uint8_t>) -> void {
+}
+
 #elif SDL_MIXER_BACKEND
-auto load_wave(SDL_RWops *rw) -> std::optional<resources::wave_t> {
-    resources::wave_t wav;
 
-    wav = Mix_LoadWAV_RW(rw, 1);
-    if (!wav)
+static auto make_wave(std::vector<int16_t> samples, const int frequency, const int channels) -> std::optional<resources::wave_t> {
+    (void)frequency;
+    (void)channels;
+
+    if (samples.empty())
         return {};
 
-    return wav;
+    // Chunk owns the buffer, Mix_FreeChunk releases it with SDL_free once allocated is set
+    const auto size = samples.size() * sizeof(int16_t);
+    auto buffer = static_cast<uint8_t*>(SDL_malloc(size));
+    if (!buffer)
+        return {};
+
+    memcpy(buffer, samples.data(), size);
+
+    auto chunk = Mix_QuickLoad_RAW(buffer, static_cast<uint32_t>(size));
+    if (!chunk) {
+        SDL_free(buffer);
+        return {};
+    }
+
+    chunk->allocated = 1;
+
+    return chunk;
+}
+
+static auto keep_file(std::optional<resources::wave_t> &, std::vector<uint8_t>) -> void {
 }
 
 #endif // SDL_MIXER_BACKEND
+
+// Data has to outlive the wave, as the archive mapping does
+auto load_wave(const uint8_t *data, const size_t size, const audio::device_format_t &format) -> std::optional<resources::wave_t> {
+    const auto span = audio::parse_wave(data, size);
+    if (!span)
+        return {};
+
+    const auto &spec = span.value().spec;
+
+#ifdef OPENAL_BACKEND
+    if (spec.format == audio::sample_format::s16)
+        if (auto wave = make_wave_view(span.value().data, span.value().size, spec.frequency, spec.channels, format); wave)
+            return wave;
+#endif // OPENAL_BACKEND
+
+    auto samples = audio::convert_pcm(span.value().data, span.value().size, spec, format);
+
+    return make_wave(std::move(samples), format.frequency, audio::get_output_channels(spec, format));
+}
+
+auto load_wave(std::vector<uint8_t> file, const audio::device_format_t &format) -> std::optional<resources::wave_t> {
+    auto wave = load_wave(file.data(), file.size(), format);
+    keep_file(wave, std::move(file));
+
+    return wave;
+}
+
+// Empty when the cached copy was made for another device format, the source is converted then
+auto load_converted_wave(const uint8_t *data, const size_t size, const audio::device_format_t &format) -> std::optional<resources::wave_t> {
+    if (!data || size < sizeof(PCM_HEADER))
+        return {};
+
+    PCM_HEADER header;
+    memcpy(&header, data, sizeof header);
+
+    const auto valid = memcmp(header.magic, PCM_MAGIC, sizeof header.magic) == 0
+            && header.version == PCM_VERSION
+            && static_cast<int>(header.frequency) == format.frequency
+            && (format.channels == 0 || static_cast<int>(header.channels) == format.channels)
+            && (header.channels == 1 || header.channels == 2)
+            && header.frames <= (size - sizeof header) / (header.channels * sizeof(int16_t)); // a product could wrap past the check
+
+    if (!valid)
+        return {};
+
+    const auto count = static_cast<size_t>(header.frames * header.channels);
+
+#ifdef OPENAL_BACKEND
+    return make_wave_view(data + sizeof header, count * sizeof(int16_t), static_cast<int>(header.frequency), static_cast<int>(header.channels), format);
+#else
+    std::vector<int16_t> samples(count);
+    memcpy(samples.data(), data + sizeof header, count * sizeof(int16_t));
+
+    return make_wave(std::move(samples), static_cast<int>(header.frequency), static_cast<int>(header.channels));
+#endif // OPENAL_BACKEND
+}
+
+auto load_converted_wave(std::vector<uint8_t> file, const audio::device_format_t &format) -> std::optional<resources::wave_t> {
+    auto wave = load_converted_wave(file.data(), file.size(), format);
+    keep_file(wave, std::move(file));
+
+    return wave;
+}
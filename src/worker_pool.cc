@@ -0,0 +1,109 @@
+#include <algorithm>
+#include <atomic>
+
+#include <SDL2/SDL.h>
+
+#include "journal.hh"
+#include "worker_pool.hh"
+#include "trace.hh"
+
+namespace workers {
+
+    static auto run(pool_t &pool) -> void {
+        trace::name_thread("worker");
+
+        while (true) {
+            std::function<void()> job;
+
+            {
+                std::unique_lock<std::mutex> guard{pool.lock};
+                pool.wakeup.wait(guard, [&pool] {
+                    return pool.stopping || !pool.jobs.empty();
+                });
+
+                if (pool.jobs.empty())
+                    return;
+
+                job = std::move(pool.jobs.front());
+                pool.jobs.pop_front();
+            }
+
+            job();
+        }
+    }
+
+    auto create_pool(size_t threads) -> std::unique_ptr<pool_t> {
+        if (threads == 0)
+            threads = static_cast<size_t>(std::max(1, SDL_GetCPUCount() - 1));
+
+        auto pool = std::make_unique<pool_t>();
+
+        pool->threads.reserve(threads);
+        for (size_t i = 0; i < threads; i++)
+            pool->threads.emplace_back(run, std::ref(*pool));
+
+        journal::debug("Worker pool started with %1 threads", threads);
+
+        return pool;
+    }
+
+    auto destroy_pool(pool_t &pool) -> void {
+        {
+            std::lock_guard<std::mutex> guard{pool.lock};
+            pool.stopping = true;
+        }
+
+        pool.wakeup.notify_all();
+
+        // Queued jobs are still run, so nobody waits forever on them
+        for (auto &t : pool.threads)
+            t.join();
+
+        pool.threads.clear();
+    }
+
+    auto submit(pool_t &pool, std::function<void()> job) -> void {
+        {
+            std::lock_guard<std::mutex> guard{pool.lock};
+            pool.jobs.push_back(std::move(job));
+        }
+
+        pool.wakeup.notify_one();
+    }
+
+    auto parallel_for(pool_t &pool, const size_t count, const std::function<void(size_t)> &fn) -> void {
+        if (count == 0)
+            return;
+
+        std::atomic<size_t> next{0};
+
+        const auto drain = [&next, count, &fn] {
+            for (auto i = next.fetch_add(1); i < count; i = next.fetch_add(1))
+                fn(i);
+        };
+
+        // Helpers reference this stack frame, so wait until every one of them has left, not just until indices run out
+        const auto helpers = std::min(pool.threads.size(), count - 1);
+        size_t finished = 0;
+        std::mutex lock;
+        std::condition_variable done;
+
+        for (size_t i = 0; i < helpers; i++) {
+            submit(pool, [&] {
+                drain();
+
+                std::lock_guard<std::mutex> guard{lock};
+                if (++finished == helpers)
+                    done.notify_one();
+            });
+        }
+
+        drain();
+
+        std::unique_lock<std::mutex> guard{lock};
+        done.wait(guard, [&] {
+            return finished == helpers;
+        });
+    }
+
+} // namespace workers
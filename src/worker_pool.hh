@@ -0,0 +1,33 @@
+#pragma once
+
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <vector>
+
+namespace workers {
+
+    typedef struct pool_type {
+        pool_type() = default;
+
+        std::vector<std::thread> threads;
+        std::deque<std::function<void()>> jobs;
+        std::mutex lock;
+        std::condition_variable wakeup;
+        bool stopping = false;
+    } pool_t;
+
+    // Zero threads means one per core minus the calling thread
+    auto create_pool(size_t threads = 0) -> std::unique_ptr<pool_t>;
+    auto destroy_pool(pool_t &pool) -> void;
+
+    auto submit(pool_t &pool, std::function<void()> job) -> void;
+
+    // Calls fn for every index in [0, count) and returns when all calls are done, the calling thread helps
+    auto parallel_for(pool_t &pool, const size_t count, const std::function<void(size_t)> &fn) -> void;
+
+} // namespace workers
@@ -0,0 +1,144 @@
+#include <cstdio>
+#include <cstring>
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "utils.hh"
+#include "archive.hh"
+
+// Packs every file under the assets directory into a single archive the game can mmap
+
+namespace {
+
+    namespace fs = std::filesystem;
+
+    struct packed_file {
+        std::string name;
+        std::vector<uint8_t> bytes;
+        ARCHIVE_ENTRY entry = {};
+    };
+
+    auto align(const uint64_t value) -> uint64_t {
+        return (value + ARCHIVE_ALIGNMENT - 1) & ~(ARCHIVE_ALIGNMENT - 1);
+    }
+
+    auto read_file(const fs::path &path, std::vector<uint8_t> &bytes) -> bool {
+        std::ifstream fs(path, std::ios::in | std::ios::binary);
+        if (!fs.is_open())
+            return false;
+
+        fs.seekg(0, std::ios::end);
+        bytes.resize(static_cast<size_t>(fs.tellg()));
+        fs.seekg(0, std::ios::beg);
+
+        return bytes.empty() || fs.read(reinterpret_cast<char*>(&bytes[0]), static_cast<std::streamsize>(bytes.size())).good();
+    }
+
+} // namespace
+
+extern auto main(int argc, char *argv[]) -> int {
+    if (argc < 3) {
+        fprintf(stderr, "Usage: %s <assets dir> <archive>\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    const fs::path root = argv[1];
+    const fs::path output = argv[2];
+
+    std::vector<packed_file> files;
+
+    std::error_code ec;
+    for (const auto &entry : fs::recursive_directory_iterator(root, ec)) {
+        if (!entry.is_regular_file())
+            continue;
+
+        packed_file f;
+        f.name = entry.path().lexically_relative(root).generic_string();
+
+        if (!read_file(entry.path(), f.bytes)) {
+            fprintf(stderr, "Can't read '%s'\n", entry.path().string().c_str());
+            return EXIT_FAILURE;
+        }
+
+        files.push_back(std::move(f));
+    }
+
+    if (ec) {
+        fprintf(stderr, "Can't read '%s': %s\n", argv[1], ec.message().c_str());
+        return EXIT_FAILURE;
+    }
+
+    for (auto &f : files) {
+        f.entry.name_hash = hash_fnv1a(f.name);
+        f.entry.content_hash = hash_fnv1a(f.bytes.data(), f.bytes.size());
+        f.entry.size = f.bytes.size();
+    }
+
+    // Runtime does a binary search by name hash
+    std::sort(files.begin(), files.end(), [] (const auto &a, const auto &b) {
+        return a.entry.name_hash != b.entry.name_hash ? a.entry.name_hash < b.entry.name_hash : a.name < b.name;
+    });
+
+    std::string names;
+    for (auto &f : files) {
+        f.entry.name_offset = static_cast<uint32_t>(names.size());
+        f.entry.name_size = static_cast<uint32_t>(f.name.size());
+        names += f.name;
+    }
+
+    ARCHIVE_HEADER header;
+    memcpy(header.magic, ARCHIVE_MAGIC, sizeof header.magic);
+    header.version = ARCHIVE_VERSION;
+    header.count = static_cast<uint32_t>(files.size());
+    header.names_size = static_cast<uint32_t>(names.size());
+    header.index_offset = sizeof header;
+    header.names_offset = header.index_offset + files.size() * sizeof(ARCHIVE_ENTRY);
+
+    auto offset = align(header.names_offset + names.size());
+    for (auto &f : files) {
+        f.entry.offset = offset;
+        offset = align(offset + f.entry.size);
+    }
+
+    const auto temp_path = output.string() + ".tmp";
+    std::ofstream fs(temp_path, std::ios::out | std::ios::binary | std::ios::trunc);
+    if (!fs.is_open()) {
+        fprintf(stderr, "Can't write '%s'\n", temp_path.c_str());
+        return EXIT_FAILURE;
+    }
+
+    fs.write(reinterpret_cast<const char*>(&header), sizeof header);
+
+    for (const auto &f : files)
+        fs.write(reinterpret_cast<const char*>(&f.entry), sizeof f.entry);
+
+    fs.write(names.data(), static_cast<std::streamsize>(names.size()));
+
+    const char padding[ARCHIVE_ALIGNMENT] = {};
+    for (const auto &f : files) {
+        const auto pos = static_cast<uint64_t>(fs.tellp());
+        fs.write(padding, static_cast<std::streamsize>(f.entry.offset - pos));
+
+        if (!f.bytes.empty())
+            fs.write(reinterpret_cast<const char*>(&f.bytes[0]), static_cast<std::streamsize>(f.bytes.size()));
+    }
+
+    fs.close();
+    if (!fs) {
+        fprintf(stderr, "Can't write '%s'\n", temp_path.c_str());
+        return EXIT_FAILURE;
+    }
+
+    fs::rename(temp_path, output, ec);
+    if (ec) {
+        fprintf(stderr, "Can't write '%s': %s\n", output.string().c_str(), ec.message().c_str());
+        return EXIT_FAILURE;
+    }
+
+    printf("%zu files packed into '%s' (%llu bytes)\n", files.size(), output.string().c_str(), static_cast<unsigned long long>(offset));
+
+    return EXIT_SUCCESS;
+}
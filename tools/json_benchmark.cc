@@ -0,0 +1,125 @@
+#include <cstdio>
+#include <cstdlib>
+#include <chrono>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <json.hpp>
+
+#include "manifest.hh"
+
+// Compares the streaming levels reader with the nlohmann DOM loader on a large generated levels.json
+
+using json = nlohmann::json;
+
+namespace {
+
+    auto generate(const size_t target_size) -> std::string {
+        std::mt19937 rng{42};
+        std::uniform_int_distribution<int> tile(0, 5);
+
+        std::string text = "{\n  \"levels\": [\n";
+        for (size_t n = 0; text.size() < target_size; n++) {
+            if (n != 0)
+                text += ",\n";
+
+            // Every tenth name has an escape, so the slow string path is exercised too
+            text += "    {\n      \"name\": \"level " + std::to_string(n) + (n % 10 == 0 ? "\\u00e9\\\"x\\\"" : "") + "\",\n";
+            text += "      \"enable\": true,\n      \"data\": [\n";
+
+            for (int y = 0; y < 64; y++) {
+                text += y ? ",\n        [" : "        [";
+                for (int x = 0; x < 64; x++) {
+                    if (x)
+                        text += ", ";
+                    text += static_cast<char>('0' + tile(rng));
+                }
+                text += "]";
+            }
+
+            text += "\n      ]\n    }";
+        }
+        text += "\n  ]\n}\n";
+
+        return text;
+    }
+
+    // Loader as it was before the streaming reader: parse to a DOM, then copy rows out
+    auto dom_checksum(const std::string &text) -> uint64_t {
+        auto j = json::parse(text);
+
+        uint64_t sum = 0;
+        for (auto &level : j["levels"]) {
+            const auto name = level.find("name") != level.end() ? level["name"].get<std::string>() : std::string{};
+            const auto enable = level.find("enable") != level.end() ? level["enable"].get<bool>() : false;
+
+            if (!enable || level.find("data") == level.end())
+                continue;
+
+            std::vector<std::vector<uint8_t>> tiles;
+            for (auto &d : level["data"])
+                tiles.push_back(d.get<std::vector<uint8_t>>());
+
+            sum += name.size();
+            for (const auto &row : tiles)
+                for (const auto t : row)
+                    sum = sum * 31 + t;
+        }
+
+        return sum;
+    }
+
+    auto stream_checksum(const std::string &text) -> uint64_t {
+        uint64_t sum = 0;
+        manifest::read_levels(text, "generated", [&sum] (const manifest::level_t &level) {
+            if (!level.enable || !level.has_data)
+                return;
+
+            sum += level.name.size();
+            for (const auto t : level.tiles)
+                sum = sum * 31 + t;
+        });
+
+        return sum;
+    }
+
+    template<typename Fn>
+    auto measure(const char *name, const size_t bytes, const int iterations, Fn &&fn) -> double {
+        using clock = std::chrono::steady_clock;
+
+        const auto start = clock::now();
+        for (int i = 0; i < iterations; i++)
+            fn();
+        const auto ms = std::chrono::duration<double, std::milli>(clock::now() - start).count() / iterations;
+
+        printf("  %-24s %8.2f ms %8.1f MB/s\n", name, ms, static_cast<double>(bytes) / (1024.0 * 1024.0) / (ms / 1000.0));
+
+        return ms;
+    }
+
+} // namespace
+
+extern auto main(int argc, char *argv[]) -> int {
+    const auto iterations = argc > 1 ? atoi(argv[1]) : 3;
+    const auto size_mb = argc > 2 ? atoi(argv[2]) : 50;
+
+    const auto text = generate(static_cast<size_t>(size_mb) * 1024 * 1024);
+    printf("levels.json, %.1f MB\n", static_cast<double>(text.size()) / (1024.0 * 1024.0));
+
+    if (dom_checksum(text) != stream_checksum(text)) {
+        fprintf(stderr, "Loaders disagree\n");
+        return EXIT_FAILURE;
+    }
+
+    const auto dom = measure("json::parse", text.size(), iterations, [&text] {
+        dom_checksum(text);
+    });
+    const auto stream = measure("manifest::read_levels", text.size(), iterations, [&text] {
+        stream_checksum(text);
+    });
+
+    printf("  speedup: %.1fx\n", dom / stream);
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,135 @@
+#include <cstdio>
+#include <cstring>
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include <json.hpp>
+
+#include "utils.hh"
+#include "level_format.hh"
+
+// Compiles levels.json into a pack the game maps and instantiates without parsing
+
+using json = nlohmann::json;
+
+extern auto main(int argc, char *argv[]) -> int {
+    if (argc < 3) {
+        fprintf(stderr, "Usage: %s <levels.json> <levels.pak>\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    const auto contents = get_config(argv[1]);
+    if (!contents) {
+        fprintf(stderr, "Can't read '%s'\n", argv[1]);
+        return EXIT_FAILURE;
+    }
+
+    json j;
+    try {
+        j = json::parse(contents.value());
+    } catch (const std::exception &e) {
+        fprintf(stderr, "Can't parse '%s': %s\n", argv[1], e.what());
+        return EXIT_FAILURE;
+    }
+
+    if (j.find("levels") == j.end()) {
+        fprintf(stderr, "No levels in '%s'\n", argv[1]);
+        return EXIT_FAILURE;
+    }
+
+    std::vector<LEVEL_PACK_ENTRY> entries;
+    std::string names;
+    std::vector<uint8_t> tiles;
+
+    for (auto &level : j["levels"]) {
+        const auto name = level.find("name") != level.end() ? level["name"].get<std::string>() : std::string{};
+        const auto enable = level.find("enable") != level.end() ? level["enable"].get<bool>() : false;
+
+        std::vector<std::vector<uint8_t>> rows;
+        if (level.find("data") != level.end()) {
+            for (auto &d : level["data"])
+                rows.push_back(d.get<std::vector<uint8_t>>());
+        }
+
+        // Width comes from the first row, like the JSON loader, short rows are padded
+        const auto width = rows.empty() ? size_t{0} : rows[0].size();
+        const auto height = rows.size();
+
+        if (width > UINT16_MAX || height > UINT16_MAX) {
+            fprintf(stderr, "Level '%s' is too large (%zux%zu)\n", name.c_str(), width, height);
+            return EXIT_FAILURE;
+        }
+
+        for (const auto &row : rows) {
+            if (row.size() != width)
+                fprintf(stderr, "Level '%s' has rows of different width, padded to %zu\n", name.c_str(), width);
+        }
+
+        LEVEL_PACK_ENTRY entry;
+        memset(&entry, 0, sizeof entry);
+        entry.name_offset = static_cast<uint32_t>(names.size());
+        entry.name_size = static_cast<uint32_t>(name.size());
+        entry.width = static_cast<uint16_t>(width);
+        entry.height = static_cast<uint16_t>(height);
+        entry.flags = enable && width > 0 && height > 0 ? static_cast<uint32_t>(LEVEL_ENABLED) : 0u;
+        entry.tiles_offset = tiles.size();
+        entry.source_hash = hash_fnv1a(level.dump());
+
+        names += name;
+
+        for (const auto &row : rows) {
+            const auto offset = tiles.size();
+            tiles.resize(offset + width, 0);
+            std::copy_n(row.begin(), std::min(width, row.size()), tiles.begin() + static_cast<std::ptrdiff_t>(offset));
+        }
+
+        entries.push_back(entry);
+    }
+
+    LEVEL_PACK_HEADER header;
+    memset(&header, 0, sizeof header);
+    memcpy(header.magic, LEVEL_PACK_MAGIC, sizeof header.magic);
+    header.version = LEVEL_PACK_VERSION;
+    header.count = static_cast<uint32_t>(entries.size());
+    header.names_size = static_cast<uint32_t>(names.size());
+    header.index_offset = sizeof header;
+    header.names_offset = header.index_offset + entries.size() * sizeof(LEVEL_PACK_ENTRY);
+    header.tiles_offset = header.names_offset + names.size();
+    header.tiles_size = tiles.size();
+    header.source_hash = hash_fnv1a(contents.value());
+
+    const auto temp_path = std::string{argv[2]} + ".tmp";
+    std::ofstream fs(temp_path, std::ios::out | std::ios::binary | std::ios::trunc);
+    if (!fs.is_open()) {
+        fprintf(stderr, "Can't write '%s'\n", temp_path.c_str());
+        return EXIT_FAILURE;
+    }
+
+    fs.write(reinterpret_cast<const char*>(&header), sizeof header);
+    if (!entries.empty())
+        fs.write(reinterpret_cast<const char*>(&entries[0]), static_cast<std::streamsize>(entries.size() * sizeof(LEVEL_PACK_ENTRY)));
+    fs.write(names.data(), static_cast<std::streamsize>(names.size()));
+    if (!tiles.empty())
+        fs.write(reinterpret_cast<const char*>(&tiles[0]), static_cast<std::streamsize>(tiles.size()));
+
+    fs.close();
+    if (!fs) {
+        fprintf(stderr, "Can't write '%s'\n", temp_path.c_str());
+        return EXIT_FAILURE;
+    }
+
+    std::error_code ec;
+    std::filesystem::rename(temp_path, argv[2], ec);
+    if (ec) {
+        fprintf(stderr, "Can't write '%s': %s\n", argv[2], ec.message().c_str());
+        return EXIT_FAILURE;
+    }
+
+    printf("%zu levels compiled into '%s' (%llu bytes)\n", entries.size(), argv[2],
+           static_cast<unsigned long long>(header.tiles_offset + header.tiles_size));
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,143 @@
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <chrono>
+#include <functional>
+#include <random>
+#include <vector>
+
+#include <SDL2/SDL_cpuinfo.h>
+
+#include "mix_kernels.hh"
+
+// Times each mixing kernel per instruction set against the scalar one, and checks they all give the same bits
+
+namespace {
+
+    constexpr size_t BLOCK_FRAMES = 512; // the software mixer's block
+    constexpr size_t CHECK_FRAMES = 509; // odd, so the scalar tails get checked too
+
+    typedef struct inputs_type {
+        inputs_type() = default;
+
+        std::vector<int16_t> s16;
+        std::vector<float> f32;
+        std::vector<float> bus; // also the saturate input, some of it out of range
+    } inputs_t;
+
+    auto generate(const size_t frames) -> inputs_t {
+        std::mt19937 rng{1234};
+        std::uniform_int_distribution<int> s16{-32768, 32767};
+        std::uniform_real_distribution<float> f32{-1.5f, 1.5f};
+
+        inputs_t in;
+        in.s16.resize(frames * 2);
+        in.f32.resize(frames * 2);
+        in.bus.resize(frames * 2);
+
+        for (auto &v : in.s16)
+            v = static_cast<int16_t>(s16(rng));
+        for (auto &v : in.f32)
+            v = f32(rng);
+        for (auto &v : in.bus)
+            v = f32(rng);
+
+        return in;
+    }
+
+    // Runs in place on bus and out, run is the iteration so pan can undo itself and stay clear of denormals
+    typedef std::function<void (const audio::mix_kernels_t &, const inputs_t &, float *, int16_t *, const size_t, const int)> kernel_t;
+
+    typedef struct case_type {
+        const char *name;
+        kernel_t kernel;
+    } case_t;
+
+    auto cases() -> std::vector<case_t> {
+        constexpr auto gain = 0.7f / 32768.0f;
+
+        return {
+            {"accumulate s16 mono", [] (const audio::mix_kernels_t &k, const inputs_t &in, float *bus, int16_t *, const size_t frames, const int) {
+                k.accumulate_s16_mono(bus, in.s16.data(), frames, gain * 0.3f, gain);
+            }},
+            {"accumulate s16 stereo", [] (const audio::mix_kernels_t &k, const inputs_t &in, float *bus, int16_t *, const size_t frames, const int) {
+                k.accumulate_s16_stereo(bus, in.s16.data(), frames, gain, gain * 0.3f);
+            }},
+            {"accumulate f32 mono", [] (const audio::mix_kernels_t &k, const inputs_t &in, float *bus, int16_t *, const size_t frames, const int) {
+                k.accumulate_f32_mono(bus, in.f32.data(), frames, 0.2f, 0.9f);
+            }},
+            {"accumulate f32 stereo", [] (const audio::mix_kernels_t &k, const inputs_t &in, float *bus, int16_t *, const size_t frames, const int) {
+                k.accumulate_f32_stereo(bus, in.f32.data(), frames, 0.9f, 0.2f);
+            }},
+            {"pan", [] (const audio::mix_kernels_t &k, const inputs_t &, float *bus, int16_t *, const size_t frames, const int run) {
+                if (run % 2 == 0)
+                    k.pan(bus, frames, 0.8f, 0.5f);
+                else
+                    k.pan(bus, frames, 1.25f, 2.0f);
+            }},
+            {"saturate s16", [] (const audio::mix_kernels_t &k, const inputs_t &, float *bus, int16_t *out, const size_t frames, const int) {
+                k.saturate_s16(out, bus, frames * 2, 32768.0f);
+            }},
+        };
+    }
+
+    // Bus and int16 output after one run on a fresh copy of the inputs
+    auto result(const case_t &c, const audio::mix_kernels_t &kernels, const inputs_t &in, const size_t frames) -> std::vector<uint8_t> {
+        auto bus = in.bus;
+        std::vector<int16_t> out(frames * 2);
+        c.kernel(kernels, in, bus.data(), out.data(), frames, 0);
+
+        std::vector<uint8_t> bytes(frames * 2 * (sizeof(float) + sizeof(int16_t)));
+        memcpy(bytes.data(), bus.data(), frames * 2 * sizeof(float));
+        memcpy(bytes.data() + frames * 2 * sizeof(float), out.data(), frames * 2 * sizeof(int16_t));
+
+        return bytes;
+    }
+
+} // namespace
+
+extern auto main(int argc, char *argv[]) -> int {
+    using clock = std::chrono::steady_clock;
+
+    const auto iterations = argc > 1 ? atoi(argv[1]) : 20000;
+
+    // Checked before asking for a table, its setup already runs the instruction set
+    std::vector<const audio::mix_kernels_t*> tables = {audio::scalar_mix_kernels()};
+    if (SDL_HasSSE2() && audio::sse2_mix_kernels())
+        tables.push_back(audio::sse2_mix_kernels());
+    if (SDL_HasAVX2() && audio::avx2_mix_kernels())
+        tables.push_back(audio::avx2_mix_kernels());
+
+    printf("%d runs of %zu frame blocks, dispatch picks %s\n", iterations, BLOCK_FRAMES, audio::select_mix_kernels()->name);
+
+    const auto check = generate(CHECK_FRAMES);
+    const auto block = generate(BLOCK_FRAMES);
+    auto failed = false;
+
+    for (const auto &c : cases()) {
+        const auto reference = result(c, *tables[0], check, CHECK_FRAMES);
+        auto scalar_ns = 0.0;
+
+        for (const auto table : tables) {
+            if (result(c, *table, check, CHECK_FRAMES) != reference) {
+                fprintf(stderr, "%s: %s differs from scalar\n", c.name, table->name);
+                failed = true;
+            }
+
+            auto bus = block.bus;
+            std::vector<int16_t> out(BLOCK_FRAMES * 2);
+
+            const auto start = clock::now();
+            for (int i = 0; i < iterations; i++)
+                c.kernel(*table, block, bus.data(), out.data(), BLOCK_FRAMES, i);
+            const auto ns = std::chrono::duration<double, std::nano>(clock::now() - start).count() / (static_cast<double>(iterations) * BLOCK_FRAMES);
+
+            if (table == tables[0])
+                scalar_ns = ns;
+
+            printf("  %-22s %-6s %7.3f ns/frame %5.2fx\n", c.name, table->name, ns, scalar_ns / ns);
+        }
+    }
+
+    return failed ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -0,0 +1,146 @@
+#include <cstdio>
+#include <cstdlib>
+#include <cmath>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+#include "mixer.hh"
+
+// Drives the software mixer on a null device: mixing cost per voice count and a producer thread feeding commands
+
+namespace {
+
+    // One second of a stereo tone, distinct per sound so voices don't mix identically
+    auto generate(const int index) -> std::vector<int16_t> {
+        std::vector<int16_t> samples(audio::MIXER_FREQUENCY * audio::MIXER_CHANNELS);
+        const auto freq = 220.0 * (index + 1);
+        for (size_t i = 0; i < samples.size() / 2; i++) {
+            const auto v = static_cast<int16_t>(std::sin(2.0 * M_PI * freq * static_cast<double>(i) / audio::MIXER_FREQUENCY) * 8000.0);
+            samples[i * 2] = v;
+            samples[i * 2 + 1] = static_cast<int16_t>(-v);
+        }
+
+        return samples;
+    }
+
+    auto checksum(const std::vector<int16_t> &output) -> uint64_t {
+        uint64_t sum = 0;
+        for (const auto s : output)
+            sum = sum * 31 + static_cast<uint16_t>(s);
+
+        return sum;
+    }
+
+} // namespace
+
+extern auto main(int argc, char *argv[]) -> int {
+    using clock = std::chrono::steady_clock;
+
+    const auto seconds = argc > 1 ? atoi(argv[1]) : 60;
+    const size_t callback_frames = argc > 2 ? static_cast<size_t>(atoi(argv[2])) : 1024;
+
+    std::vector<std::vector<int16_t>> sounds;
+    for (int i = 0; i < 8; i++)
+        sounds.push_back(generate(i));
+
+    std::vector<int16_t> output(callback_frames * audio::MIXER_CHANNELS);
+    const auto total_frames = static_cast<size_t>(seconds) * audio::MIXER_FREQUENCY;
+
+    printf("%d s of audio in %zu frame callbacks\n", seconds, callback_frames);
+
+    for (const auto voices : {1u, 8u, 16u, 32u}) {
+        auto mixer = audio::create_mixer();
+        for (uint32_t v = 0; v < voices; v++) {
+            const auto &s = sounds[v % sounds.size()];
+            audio::submit_play(*mixer, s.data(), static_cast<uint32_t>(s.size() / audio::MIXER_CHANNELS), 0.1f, true);
+        }
+
+        const auto start = clock::now();
+        for (size_t done = 0; done < total_frames; done += callback_frames)
+            audio::mix(*mixer, output.data(), callback_frames);
+        const auto elapsed = std::chrono::duration<double>(clock::now() - start).count();
+
+        printf("  %2u voices %8.2f ns/frame %10.0fx realtime\n", voices, elapsed * 1e9 / static_cast<double>(total_frames), seconds / elapsed);
+    }
+
+    // Game thread stand-in fires one-shots while the audio thread mixes, every play has to start a voice or be counted as dropped
+    constexpr uint64_t plays = 100000;
+    constexpr uint32_t play_frames = 256;
+
+    auto mixer = audio::create_mixer();
+    std::atomic<bool> sending{true};
+    uint64_t sent = 0; // read once sending is cleared
+
+    std::thread producer{[&] {
+        while (sent < plays) {
+            const auto &s = sounds[sent % sounds.size()];
+            if (audio::submit_play(*mixer, s.data(), play_frames, 0.1f, false))
+                sent++;
+            else
+                std::this_thread::yield();
+        }
+
+        sending.store(false, std::memory_order_release);
+    }};
+
+    // Mixes until every command sent is consumed, a torn command shows up as a voice that matches no sound
+    auto torn = uint64_t{0};
+    const auto deadline = clock::now() + std::chrono::seconds{30};
+
+    while (clock::now() < deadline) {
+        const auto done = !sending.load(std::memory_order_acquire);
+
+        audio::mix(*mixer, output.data(), callback_frames);
+
+        for (const auto &voice : mixer->voices) {
+            if (!voice.samples)
+                continue;
+
+            const auto known = std::any_of(sounds.begin(), sounds.end(), [&voice] (const auto &s) {
+                return s.data() == voice.samples;
+            });
+
+            if (!known || voice.frames != play_frames || voice.looped)
+                torn++;
+        }
+
+        if (done && mixer->started_voices.load() + mixer->dropped_voices.load() == sent)
+            break;
+    }
+
+    producer.join();
+
+    const auto started = mixer->started_voices.load();
+    const auto dropped = mixer->dropped_voices.load();
+
+    printf("  producer: %llu plays sent, %llu queue full, %llu started, %llu without a free voice\n", static_cast<unsigned long long>(sent),
+           static_cast<unsigned long long>(mixer->dropped_commands), static_cast<unsigned long long>(started), static_cast<unsigned long long>(dropped));
+
+    if (sent != plays || started + dropped != sent || torn != 0) {
+        fprintf(stderr, "Commands lost or torn: %llu sent, %llu started, %llu dropped, %llu torn\n", static_cast<unsigned long long>(sent),
+                static_cast<unsigned long long>(started), static_cast<unsigned long long>(dropped), static_cast<unsigned long long>(torn));
+        return EXIT_FAILURE;
+    }
+
+    // Same commands mix to the same samples
+    uint64_t sums[2] = {};
+    for (auto &sum : sums) {
+        auto m = audio::create_mixer();
+        audio::submit_play(*m, sounds[0].data(), 30000, 0.5f, false);
+        audio::submit_play(*m, sounds[3].data(), 44100, 0.7f, true);
+        for (int i = 0; i < 100; i++) {
+            audio::mix(*m, output.data(), callback_frames);
+            sum = sum * 7 + checksum(output);
+        }
+    }
+
+    if (sums[0] != sums[1]) {
+        fprintf(stderr, "Mixer output is not deterministic\n");
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,94 @@
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <filesystem>
+#include <vector>
+
+#include <SDL2/SDL_rwops.h>
+
+#include "pcm_convert.hh"
+#include "pcm_format.hh"
+
+// Converts every WAV under a directory to stereo int16 at each given rate, the game loads these instead of resampling
+
+namespace {
+
+    namespace fs = std::filesystem;
+
+    auto convert(const fs::path &src, const fs::path &dst, const int frequency) -> bool {
+        audio::device_format_t format;
+        format.frequency = frequency;
+        format.channels = 2;
+
+        auto channels = 0;
+        const auto samples = audio::load_pcm_wave(SDL_RWFromFile(src.string().c_str(), "rb"), format, channels);
+        if (samples.empty()) {
+            fprintf(stderr, "Can't convert '%s'\n", src.string().c_str());
+            return false;
+        }
+
+        PCM_HEADER header;
+        memset(&header, 0, sizeof header);
+        memcpy(header.magic, PCM_MAGIC, sizeof header.magic);
+        header.version = PCM_VERSION;
+        header.frequency = static_cast<uint32_t>(frequency);
+        header.channels = static_cast<uint32_t>(channels);
+        header.frames = samples.size() / static_cast<size_t>(channels);
+
+        auto fp = fopen(dst.string().c_str(), "wb");
+        if (!fp) {
+            fprintf(stderr, "Can't write '%s'\n", dst.string().c_str());
+            return false;
+        }
+
+        const auto written = fwrite(&header, sizeof header, 1, fp) == 1 && fwrite(samples.data(), samples.size() * sizeof(int16_t), 1, fp) == 1;
+        fclose(fp);
+
+        printf("%s -> %s (%u Hz, %u frames)\n", src.string().c_str(), dst.string().c_str(), header.frequency, static_cast<uint32_t>(header.frames));
+
+        return written;
+    }
+
+} // namespace
+
+extern auto main(int argc, char *argv[]) -> int {
+    if (argc < 2) {
+        fprintf(stderr, "Usage: %s <assets dir> [frequency...]\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    std::vector<int> frequencies;
+    for (int i = 2; i < argc; i++)
+        frequencies.push_back(atoi(argv[i]));
+
+    if (frequencies.empty())
+        frequencies.push_back(44100);
+
+    std::error_code ec;
+    auto failed = 0;
+
+    for (const auto &entry : fs::recursive_directory_iterator(argv[1], ec)) {
+        if (!entry.is_regular_file() || entry.path().extension() != ".wav")
+            continue;
+
+        for (const auto frequency : frequencies) {
+            auto dst = entry.path();
+            dst.replace_extension("." + std::to_string(frequency) + ".pcm");
+
+            // Skip up to date files, so the target is cheap to rebuild
+            if (fs::exists(dst) && fs::last_write_time(dst) >= fs::last_write_time(entry.path()))
+                continue;
+
+            if (!convert(entry.path(), dst, frequency))
+                failed++;
+        }
+    }
+
+    if (ec) {
+        fprintf(stderr, "Can't read '%s': %s\n", argv[1], ec.message().c_str());
+        return EXIT_FAILURE;
+    }
+
+    return failed == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
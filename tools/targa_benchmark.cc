@@ -0,0 +1,197 @@
+#include <cstdio>
+#include <cstring>
+#include <chrono>
+#include <optional>
+#include <random>
+#include <vector>
+
+#include <SDL2/SDL_rwops.h>
+
+#include "resources.hh"
+
+// Compares the in-memory TGA decoder with the old SDL_RWread based loader on large generated images
+
+auto load_targa(SDL_RWops *rw) -> std::optional<resources::image_t>;
+auto decode_targa(const uint8_t *data, const size_t size, const bool swizzle) -> std::optional<resources::image_t>;
+
+namespace {
+
+    // Loader as it was before the in-memory decoder, kept byte for byte as the baseline
+    auto legacy_load_targa(SDL_RWops *rw) -> std::optional<resources::image_t> {
+        if (!rw)
+            return {};
+
+        resources::image_t image;
+
+        Sint64 lenght = SDL_RWsize(rw);
+
+        uint8_t header[18];
+        SDL_RWread(rw, header, sizeof(header), 1);
+
+        const uint8_t data_type = header[2];
+        const uint16_t width = static_cast<uint16_t>(header[12] | header[13] << 8);
+        const uint16_t height = static_cast<uint16_t>(header[14] | header[15] << 8);
+        const uint8_t bpp = header[16];
+
+        const uint8_t bytesperpixel = bpp / 8;
+        std::vector<uint8_t> data;
+        data.resize(width * height * (bytesperpixel + 1));
+
+        uint8_t *pdata = &data[0];
+
+        if (data_type == 10) {
+            uint8_t block = 0;
+            size_t readen = 0;
+
+            for (int i = 0; i < width * height; i++) {
+                readen = SDL_RWread(rw, &block, 1, 1);
+
+                if (readen) {
+                    uint8_t count = (block & 0x7f) + 1;
+
+                    if (block & 0x80) {
+                        uint8_t bytes[4] = {0};
+                        SDL_RWread(rw, bytes, bytesperpixel, 1);
+
+                        for(int j = 0; j < count; j++) {
+                            memcpy(pdata, bytes, bytesperpixel);
+                            pdata += bytesperpixel;
+                        }
+                    } else {
+                        SDL_RWread(rw, pdata, bytesperpixel * count, 1);
+                        pdata += bytesperpixel * count;
+                    }
+                }
+            }
+
+            SDL_RWclose(rw);
+        }
+        else if (data_type == 2 || data_type == 3) {
+            if (!SDL_RWread(rw, &data[0], lenght - sizeof(header), 1))
+                SDL_RWclose(rw);
+        }
+
+        image.format = bpp == 32 ? resources::pixel_format::bgra8 : resources::pixel_format::bgr8;
+        image.width = width;
+        image.height = height;
+        image.depth = 0;
+        image.pixels = data;
+
+        return image;
+    }
+
+    // Sprite-like content: long flat runs mixed with noisy stretches
+    auto generate(const uint16_t width, const uint16_t height, const uint8_t bpp, const bool rle) -> std::vector<uint8_t> {
+        std::mt19937 rng{42};
+        const size_t bytesperpixel = bpp / 8u;
+
+        std::vector<uint8_t> pixels(static_cast<size_t>(width) * height * bytesperpixel);
+        for (size_t i = 0; i < pixels.size();) {
+            const auto run = 1 + rng() % 200;
+            uint8_t color[4] = {static_cast<uint8_t>(rng()), static_cast<uint8_t>(rng()), static_cast<uint8_t>(rng()), 255};
+            const auto noisy = rng() % 4 == 0;
+
+            for (uint32_t j = 0; j < run && i < pixels.size(); j++, i += bytesperpixel) {
+                for (size_t c = 0; c < bytesperpixel; c++)
+                    pixels[i + c] = noisy ? static_cast<uint8_t>(rng()) : color[c];
+            }
+        }
+
+        std::vector<uint8_t> file(18, 0);
+        file[2] = rle ? 10 : 2;
+        file[12] = static_cast<uint8_t>(width & 0xff);
+        file[13] = static_cast<uint8_t>(width >> 8);
+        file[14] = static_cast<uint8_t>(height & 0xff);
+        file[15] = static_cast<uint8_t>(height >> 8);
+        file[16] = bpp;
+
+        if (!rle) {
+            file.insert(file.end(), pixels.begin(), pixels.end());
+            return file;
+        }
+
+        const auto pixel_count = pixels.size() / bytesperpixel;
+        const auto same = [&] (size_t a, size_t b) {
+            return memcmp(&pixels[a * bytesperpixel], &pixels[b * bytesperpixel], bytesperpixel) == 0;
+        };
+
+        for (size_t i = 0; i < pixel_count;) {
+            size_t run = 1;
+            while (i + run < pixel_count && run < 128 && same(i, i + run))
+                run++;
+
+            if (run > 1) {
+                file.push_back(static_cast<uint8_t>(0x80 | (run - 1)));
+                file.insert(file.end(), &pixels[i * bytesperpixel], &pixels[i * bytesperpixel] + bytesperpixel);
+            } else {
+                while (i + run < pixel_count && run < 128 && !same(i + run - 1, i + run))
+                    run++;
+
+                file.push_back(static_cast<uint8_t>(run - 1));
+                file.insert(file.end(), &pixels[i * bytesperpixel], &pixels[(i + run) * bytesperpixel]);
+            }
+
+            i += run;
+        }
+
+        return file;
+    }
+
+    template<typename Fn>
+    auto measure(const char *name, const size_t pixel_bytes, const int iterations, Fn &&fn) -> double {
+        using clock = std::chrono::steady_clock;
+
+        fn();
+
+        const auto start = clock::now();
+        for (int i = 0; i < iterations; i++)
+            fn();
+        const auto ms = std::chrono::duration<double, std::milli>(clock::now() - start).count() / iterations;
+
+        printf("  %-24s %8.2f ms %8.1f MB/s\n", name, ms, static_cast<double>(pixel_bytes) / (1024.0 * 1024.0) / (ms / 1000.0));
+
+        return ms;
+    }
+
+} // namespace
+
+extern auto main(int argc, char *argv[]) -> int {
+    const auto iterations = argc > 1 ? atoi(argv[1]) : 10;
+
+    struct {
+        uint8_t bpp;
+        bool rle;
+    } cases[] = {{32, true}, {24, true}, {32, false}, {24, false}};
+
+    for (const auto &c : cases) {
+        const uint16_t width = 4096, height = 4096;
+        const auto file = generate(width, height, c.bpp, c.rle);
+        const auto pixel_bytes = static_cast<size_t>(width) * height * (c.bpp / 8u);
+
+        printf("%ux%u %u-bit %s, %.1f MB file\n", width, height, c.bpp, c.rle ? "RLE" : "raw", static_cast<double>(file.size()) / (1024.0 * 1024.0));
+
+        const auto legacy = legacy_load_targa(SDL_RWFromConstMem(file.data(), static_cast<int>(file.size())));
+        const auto current = decode_targa(file.data(), file.size(), false);
+        if (!legacy || !current || memcmp(legacy.value().pixels.data(), current.value().pixels.data(), pixel_bytes) != 0) {
+            fprintf(stderr, "Decoders disagree\n");
+            return EXIT_FAILURE;
+        }
+
+        const auto base = measure("legacy load_targa", pixel_bytes, iterations, [&file] {
+            legacy_load_targa(SDL_RWFromConstMem(file.data(), static_cast<int>(file.size())));
+        });
+        const auto rw = measure("load_targa", pixel_bytes, iterations, [&file] {
+            load_targa(SDL_RWFromConstMem(file.data(), static_cast<int>(file.size())));
+        });
+        const auto span = measure("decode_targa", pixel_bytes, iterations, [&file] {
+            decode_targa(file.data(), file.size(), false);
+        });
+        const auto swizzled = measure("decode_targa swizzle", pixel_bytes, iterations, [&file] {
+            decode_targa(file.data(), file.size(), true);
+        });
+
+        printf("  speedup: load_targa %.1fx, decode_targa %.1fx, swizzle %.1fx\n", base / rw, base / span, base / swizzled);
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,316 @@
+#include <cstdio>
+#include <cstring>
+#include <algorithm>
+#include <filesystem>
+#include <optional>
+#include <vector>
+
+#include <SDL2/SDL_rwops.h>
+
+#include "resources.hh"
+#include "dds.hh"
+
+// Converts every TGA under a directory to a BC1 (opaque) or BC3 (with alpha) DDS with a full mip chain
+
+auto load_targa(SDL_RWops *rw) -> std::optional<resources::image_t>;
+
+namespace {
+
+    namespace fs = std::filesystem;
+
+    struct rgba {
+        uint8_t r = 0;
+        uint8_t g = 0;
+        uint8_t b = 0;
+        uint8_t a = 255;
+    };
+
+    typedef struct surface_type {
+        uint32_t width = 0;
+        uint32_t height = 0;
+        std::vector<rgba> pixels;
+    } surface_t;
+
+    auto to_surface(const resources::image_t &image) -> std::optional<surface_t> {
+        surface_t s;
+        s.width = image.width;
+        s.height = image.height;
+        s.pixels.resize(static_cast<size_t>(image.width) * image.height);
+
+        const uint8_t *src = image.pixels.data();
+
+        for (auto &p : s.pixels) {
+            switch (image.format) {
+            case resources::pixel_format::r8:
+                p = rgba{src[0], src[0], src[0], 255};
+                src += 1;
+                break;
+            case resources::pixel_format::bgr8:
+                p = rgba{src[2], src[1], src[0], 255};
+                src += 3;
+                break;
+            case resources::pixel_format::bgra8:
+                p = rgba{src[2], src[1], src[0], src[3]};
+                src += 4;
+                break;
+            default:
+                return {};
+            }
+        }
+
+        return s;
+    }
+
+    auto downsample(const surface_t &s) -> surface_t {
+        surface_t d;
+        d.width = std::max(1u, s.width / 2);
+        d.height = std::max(1u, s.height / 2);
+        d.pixels.resize(static_cast<size_t>(d.width) * d.height);
+
+        const auto at = [&s] (uint32_t x, uint32_t y) -> const rgba& {
+            return s.pixels[std::min(y, s.height - 1) * s.width + std::min(x, s.width - 1)];
+        };
+
+        for (uint32_t y = 0; y < d.height; y++) {
+            for (uint32_t x = 0; x < d.width; x++) {
+                const rgba *q[4] = {&at(x * 2, y * 2), &at(x * 2 + 1, y * 2), &at(x * 2, y * 2 + 1), &at(x * 2 + 1, y * 2 + 1)};
+
+                auto &p = d.pixels[y * d.width + x];
+                p.r = static_cast<uint8_t>((q[0]->r + q[1]->r + q[2]->r + q[3]->r + 2) / 4);
+                p.g = static_cast<uint8_t>((q[0]->g + q[1]->g + q[2]->g + q[3]->g + 2) / 4);
+                p.b = static_cast<uint8_t>((q[0]->b + q[1]->b + q[2]->b + q[3]->b + 2) / 4);
+                p.a = static_cast<uint8_t>((q[0]->a + q[1]->a + q[2]->a + q[3]->a + 2) / 4);
+            }
+        }
+
+        return d;
+    }
+
+    auto to_565(const rgba &c) -> uint16_t {
+        return static_cast<uint16_t>(((c.r * 31 + 127) / 255) << 11 | ((c.g * 63 + 127) / 255) << 5 | ((c.b * 31 + 127) / 255));
+    }
+
+    auto from_565(const uint16_t v) -> rgba {
+        const auto r = (v >> 11) & 31;
+        const auto g = (v >> 5) & 63;
+        const auto b = v & 31;
+
+        return rgba{static_cast<uint8_t>((r << 3) | (r >> 2)), static_cast<uint8_t>((g << 2) | (g >> 4)), static_cast<uint8_t>((b << 3) | (b >> 2)), 255};
+    }
+
+    auto put16(uint8_t *out, const uint16_t v) {
+        out[0] = static_cast<uint8_t>(v & 0xff);
+        out[1] = static_cast<uint8_t>(v >> 8);
+    }
+
+    // Bounding box fit, inset a little to reduce error at the extremes
+    auto encode_color_block(const rgba (&block)[16], uint8_t *out) {
+        rgba lo{255, 255, 255, 255}, hi{0, 0, 0, 255};
+        for (const auto &p : block) {
+            lo.r = std::min(lo.r, p.r); lo.g = std::min(lo.g, p.g); lo.b = std::min(lo.b, p.b);
+            hi.r = std::max(hi.r, p.r); hi.g = std::max(hi.g, p.g); hi.b = std::max(hi.b, p.b);
+        }
+
+        const auto inset = [] (uint8_t &l, uint8_t &h) {
+            const auto d = (h - l) / 16;
+            l = static_cast<uint8_t>(l + d);
+            h = static_cast<uint8_t>(h - d);
+        };
+        inset(lo.r, hi.r); inset(lo.g, hi.g); inset(lo.b, hi.b);
+
+        auto c0 = to_565(hi);
+        auto c1 = to_565(lo);
+        if (c0 < c1)
+            std::swap(c0, c1);
+
+        put16(out, c0);
+        put16(out + 2, c1);
+
+        uint32_t indices = 0;
+        if (c0 != c1) {
+            const auto p0 = from_565(c0);
+            const auto p1 = from_565(c1);
+            const rgba palette[4] = {
+                p0,
+                p1,
+                rgba{static_cast<uint8_t>((2 * p0.r + p1.r) / 3), static_cast<uint8_t>((2 * p0.g + p1.g) / 3), static_cast<uint8_t>((2 * p0.b + p1.b) / 3), 255},
+                rgba{static_cast<uint8_t>((p0.r + 2 * p1.r) / 3), static_cast<uint8_t>((p0.g + 2 * p1.g) / 3), static_cast<uint8_t>((p0.b + 2 * p1.b) / 3), 255}
+            };
+
+            for (int i = 0; i < 16; i++) {
+                auto best = 0u;
+                auto best_error = INT32_MAX;
+                for (auto j = 0u; j < 4; j++) {
+                    const auto dr = block[i].r - palette[j].r;
+                    const auto dg = block[i].g - palette[j].g;
+                    const auto db = block[i].b - palette[j].b;
+                    const auto error = dr * dr + dg * dg + db * db;
+                    if (error < best_error) {
+                        best_error = error;
+                        best = j;
+                    }
+                }
+
+                indices |= best << (i * 2);
+            }
+        }
+
+        for (int i = 0; i < 4; i++)
+            out[4 + i] = static_cast<uint8_t>(indices >> (i * 8));
+    }
+
+    auto encode_alpha_block(const rgba (&block)[16], uint8_t *out) {
+        uint8_t a0 = 0, a1 = 255;
+        for (const auto &p : block) {
+            a0 = std::max(a0, p.a);
+            a1 = std::min(a1, p.a);
+        }
+
+        out[0] = a0;
+        out[1] = a1;
+
+        uint64_t indices = 0;
+        if (a0 != a1) {
+            int palette[8] = {a0, a1};
+            for (int i = 1; i < 7; i++)
+                palette[i + 1] = ((7 - i) * a0 + i * a1) / 7;
+
+            for (int i = 0; i < 16; i++) {
+                auto best = 0ull;
+                auto best_error = INT32_MAX;
+                for (auto j = 0u; j < 8; j++) {
+                    const auto error = std::abs(block[i].a - palette[j]);
+                    if (error < best_error) {
+                        best_error = error;
+                        best = j;
+                    }
+                }
+
+                indices |= best << (i * 3);
+            }
+        }
+
+        for (int i = 0; i < 6; i++)
+            out[2 + i] = static_cast<uint8_t>(indices >> (i * 8));
+    }
+
+    auto encode_level(const surface_t &s, const bool alpha, std::vector<uint8_t> &out) {
+        const auto block_size = alpha ? 16u : 8u;
+
+        for (uint32_t by = 0; by < s.height; by += 4) {
+            for (uint32_t bx = 0; bx < s.width; bx += 4) {
+                rgba block[16];
+                for (uint32_t y = 0; y < 4; y++)
+                    for (uint32_t x = 0; x < 4; x++)
+                        block[y * 4 + x] = s.pixels[std::min(by + y, s.height - 1) * s.width + std::min(bx + x, s.width - 1)];
+
+                const auto offset = out.size();
+                out.resize(offset + block_size);
+
+                if (alpha) {
+                    encode_alpha_block(block, &out[offset]);
+                    encode_color_block(block, &out[offset + 8]);
+                } else {
+                    encode_color_block(block, &out[offset]);
+                }
+            }
+        }
+    }
+
+    auto compress(const fs::path &src, const fs::path &dst) -> bool {
+        auto rw = SDL_RWFromFile(src.string().c_str(), "rb");
+        if (!rw) {
+            fprintf(stderr, "Can't open '%s'\n", src.string().c_str());
+            return false;
+        }
+
+        const auto image = load_targa(rw);
+        if (!image) {
+            fprintf(stderr, "Can't load '%s'\n", src.string().c_str());
+            return false;
+        }
+
+        auto surface = to_surface(image.value());
+        if (!surface) {
+            fprintf(stderr, "Unsupported pixel format in '%s'\n", src.string().c_str());
+            return false;
+        }
+
+        const auto alpha = std::any_of(surface.value().pixels.begin(), surface.value().pixels.end(), [] (const auto &p) {
+            return p.a != 255;
+        });
+
+        std::vector<uint8_t> data;
+        auto levels = 0u;
+        auto level = surface.value();
+        while (true) {
+            encode_level(level, alpha, data);
+            levels++;
+
+            if (level.width == 1 && level.height == 1)
+                break;
+
+            level = downsample(level);
+        }
+
+        DDS_HEADER header;
+        memset(&header, 0, sizeof header);
+        header.magic = DDS_MAGIC;
+        header.size = sizeof header - sizeof header.magic;
+        header.flags = DDSD_CAPS | DDSD_HEIGHT | DDSD_WIDTH | DDSD_PIXELFORMAT | DDSD_MIPMAPCOUNT | DDSD_LINEARSIZE;
+        header.height = image.value().height;
+        header.width = image.value().width;
+        header.linear_size = std::max(1u, (header.width + 3) / 4) * std::max(1u, (header.height + 3) / 4) * (alpha ? 16 : 8);
+        header.mipmap_count = levels;
+        header.pixel_format.size = sizeof header.pixel_format;
+        header.pixel_format.flags = DDPF_FOURCC;
+        header.pixel_format.fourcc = alpha ? DDS_FOURCC_DXT5 : DDS_FOURCC_DXT1;
+        header.caps = DDSCAPS_TEXTURE | DDSCAPS_MIPMAP | DDSCAPS_COMPLEX;
+
+        auto fp = fopen(dst.string().c_str(), "wb");
+        if (!fp) {
+            fprintf(stderr, "Can't write '%s'\n", dst.string().c_str());
+            return false;
+        }
+
+        const auto written = fwrite(&header, sizeof header, 1, fp) == 1 && fwrite(data.data(), data.size(), 1, fp) == 1;
+        fclose(fp);
+
+        printf("%s -> %s (%s, %ux%u, %u levels)\n", src.string().c_str(), dst.string().c_str(), alpha ? "BC3" : "BC1", header.width, header.height, levels);
+
+        return written;
+    }
+
+} // namespace
+
+extern auto main(int argc, char *argv[]) -> int {
+    if (argc < 2) {
+        fprintf(stderr, "Usage: %s <assets dir>\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    std::error_code ec;
+    auto failed = 0;
+
+    for (const auto &entry : fs::recursive_directory_iterator(argv[1], ec)) {
+        if (!entry.is_regular_file() || entry.path().extension() != ".tga")
+            continue;
+
+        auto dst = entry.path();
+        dst.replace_extension(".dds");
+
+        // Skip up to date files, so the target is cheap to rebuild
+        if (fs::exists(dst) && fs::last_write_time(dst) >= fs::last_write_time(entry.path()))
+            continue;
+
+        if (!compress(entry.path(), dst))
+            failed++;
+    }
+
+    if (ec) {
+        fprintf(stderr, "Can't read '%s': %s\n", argv[1], ec.message().c_str());
+        return EXIT_FAILURE;
+    }
+
+    return failed == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}